@@ -2,19 +2,161 @@
 #include "src/scheduler.h"
 #include "src/coroutine.h"
 #include "src/sort.h"
+#include "src/cache.h"
+#include "src/query.h"
+#include "src/workers.h"
+#include "src/large_test.h"
 
 #include <stdio.h>
 #include <time.h>
 #include <memory.h>
+#include <getopt.h>
+
+static void print_usage() {
+  fprintf(stderr, "Usage: ./sort [options] in_file1 [in_file2 ...]\n"
+                  "  --cache-dir dir       reuse sorted runs of unchanged inputs, stored in dir\n"
+                  "  --top k               store only k greatest values\n"
+                  "  --bottom k            store only k least values\n"
+                  "  --quantiles[=p1,...]  store the quantiles of all values (min, quartiles and max by default)\n"
+                  "  --unique              store every distinct value once\n"
+                  "  --count               store every distinct value once, along with its count\n"
+                  "  --packed              store sorted values in the packed binary format, accepted as input too\n"
+                  "  --direct-io           read and write files with O_DIRECT, bypassing the page cache\n"
+                  "  --drop-cache          drop read and written pages from the page cache behind the sort\n"
+                  "  --workers w           sort the files in w processes instead of threads of one\n"
+                  "  --self-test-large[=n] check the merges on n synthetic values (past 2^32 by default) and exit\n");
+}
+
+static bool sort_files_in_coroutines(const char** files, int file_count, const sort_task_t* settings,
+                                     buffer_t* buffers) {
+  if (!scheduler_initialize(file_count, false)) {
+    return false;
+  }
+  for (int i = 0; i < file_count; ++i) {
+    sort_task_t* task = malloc(sizeof(*task));
+    if (!task) {
+      perror("couldn't allocate task.");
+      return false;
+    }
+    *task = *settings;
+    task->buffer = &buffers[i];
+    task->filename = files[i];
+    if (!scheduler_add_task(coro_sort_file, task)) {
+      return false;
+    }
+  }
+
+  bool ok = scheduler_run_loop();
+  scheduler_destroy();
+  return ok;
+}
+
+static bool parse_count(const char* str, size_t* count) {
+  char* end;
+  unsigned long long val = strtoull(str, &end, 10);
+  if (end == str || *end || *str == '-') {
+    fprintf(stderr, "Invalid count: %s\n", str);
+    return false;
+  }
+  *count = val;
+  return true;
+}
 
 int main(int argc, char** argv) {
   clock_t start_time = clock();
-  if (argc < 2) {
-    fprintf(stderr, "Usage: ./sort in_file1 [in_file2 ...]");
+
+  const char* cache_dir = NULL;
+  int worker_count = 1;
+  query_t query = {.mode = FullSort, .merge_mode = MergeAll, .packed_output = false,
+                   .io_mode = CachedIO, .k = 0, .quantile_count = 0};
+  static const struct option long_options[] = {
+      {"cache-dir", required_argument, NULL, 'c'},
+      {"top", required_argument, NULL, 't'},
+      {"bottom", required_argument, NULL, 'b'},
+      {"quantiles", optional_argument, NULL, 'q'},
+      {"unique", no_argument, NULL, 'u'},
+      {"count", no_argument, NULL, 'n'},
+      {"packed", no_argument, NULL, 'p'},
+      {"direct-io", no_argument, NULL, 'd'},
+      {"drop-cache", no_argument, NULL, 'D'},
+      {"workers", required_argument, NULL, 'w'},
+      {"self-test-large", optional_argument, NULL, 'L'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        cache_dir = optarg;
+        break;
+      case 't':
+      case 'b':
+        query.mode = (opt == 't' ? TopK : BottomK);
+        if (!parse_count(optarg, &query.k)) {
+          return -1;
+        }
+        break;
+      case 'q':
+        query.mode = Quantiles;
+        if (!query_parse_quantiles(optarg, &query)) {
+          return -1;
+        }
+        break;
+      case 'u':
+        query.merge_mode = MergeUnique;
+        break;
+      case 'n':
+        query.merge_mode = MergeCount;
+        break;
+      case 'p':
+        query.packed_output = true;
+        break;
+      case 'd':
+        query.io_mode = DirectIO;
+        break;
+      case 'D':
+        query.io_mode = NoCacheIO;
+        break;
+      case 'w': {
+        size_t count;
+        if (!parse_count(optarg, &count) || count == 0 || count > 1024) {
+          fprintf(stderr, "Worker count should be in [1, 1024]\n");
+          return -1;
+        }
+        worker_count = (int)count;
+        break;
+      }
+      case 'L': {
+        size_t count = large_test_default_count;
+        if (optarg && !parse_count(optarg, &count)) {
+          return -1;
+        }
+        return large_test_run(count) ? 0 : 1;
+      }
+      default:
+        print_usage();
+        return -1;
+    }
+  }
+  if (query.merge_mode != MergeAll && query.mode != FullSort) {
+    fprintf(stderr, "--unique and --count can't be combined with --top, --bottom or --quantiles\n");
+    return -1;
+  }
+  if (query.packed_output && (query.mode == Quantiles || query.merge_mode == MergeCount)) {
+    fprintf(stderr, "--packed can't be combined with --quantiles or --count\n");
     return -1;
   }
+  if (optind >= argc) {
+    print_usage();
+    return -1;
+  }
+  if (cache_dir && !cache_prepare_dir(cache_dir)) {
+    return -1;
+  }
+
   bool ok = true;
-  for (int i = 1; i < argc; ++i) {
+  for (int i = optind; i < argc; ++i) {
     if (!check_if_exists(argv[i])) {
       ok = false;
     }
@@ -22,48 +164,27 @@ int main(int argc, char** argv) {
   if (!ok) {
     return -1;
   }
-  int in_file_count = argc - 1;
+  int in_file_count = argc - optind;
   const char* out_filename = "result.txt";
 
-  ok = scheduler_initialize(in_file_count);
-  if (!ok) {
-    return -1;
-  }
-
-  buffer_t* input_buffers = reallocarray(NULL, in_file_count, sizeof(buffer_t));
+  buffer_t* input_buffers = calloc(in_file_count, sizeof(buffer_t));
   if (!input_buffers) {
     perror("couldn't allocate buffers.");
     return -1;
   }
-  buffer_t out_buffer = {.size =  0, .buf =  NULL};
-  for (int i = 1; i < argc; ++i) {
-    input_buffers[i - 2].size = 0;
-    input_buffers[i - 2].buf = NULL;
-
-    struct s_arg {
-      const char* filename;
-      buffer_t* buffer;
-    }* var = malloc(sizeof(*var));
-    var->buffer = &input_buffers[i - 1];
-    var->filename = argv[i];
-    ok = scheduler_add_task(coro_sort_file, var);
-    if (!ok) {
-      return -1;
-    }
-  }
-
-  ok = scheduler_run_loop();
-  if (!ok) {
-    return -1;
+  sort_task_t settings = {.filename = NULL, .buffer = NULL, .cache_dir = cache_dir, .query = &query};
+  const char** files = (const char**)&argv[optind];
+  if (worker_count > 1) {
+    ok = workers_sort_files(files, in_file_count, worker_count, &settings, input_buffers);
+  } else {
+    ok = sort_files_in_coroutines(files, in_file_count, &settings, input_buffers);
   }
-  scheduler_destroy();
-
-  ok = merge_sorted_buffers(input_buffers, in_file_count, &out_buffer);
   if (!ok) {
     return -1;
   }
-  ok = store_buffer_to_file(out_buffer, out_filename);
 
+  ok = query_combine_and_store(&query, input_buffers, in_file_count, out_filename);
+  workers_release();
   if (!ok) {
     return -1;
   }
@@ -0,0 +1,191 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "cache.h"
+#include "packed_run.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <memory.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define cache_magic 0x4e55524454524f53ULL // "SORTDRUN"
+#define cache_version 2
+
+struct cache_header_s {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t path_length;
+
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+
+  uint64_t count;
+  // Hash of the run itself, so a damaged cache file is never merged.
+  uint64_t checksum;
+};
+// The header is followed by path_length bytes of the input path and the sorted run in the packed format.
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+  const unsigned char* bytes = data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint64_t hash_run(const int* values, size_t count) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < count; ++i) {
+    hash = (hash ^ (uint32_t)values[i]) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+static bool run_path(const char* cache_dir, const run_fingerprint_t* fingerprint, char* path, size_t size) {
+  uint64_t key = hash_bytes(0xcbf29ce484222325ULL, fingerprint->path, strlen(fingerprint->path));
+  int ret = snprintf(path, size, "%s/%016llx.run", cache_dir, (unsigned long long)key);
+  return ret > 0 && (size_t)ret < size;
+}
+
+bool cache_prepare_dir(const char* cache_dir) {
+  if (mkdir(cache_dir, 0755) == -1 && errno != EEXIST) {
+    perror("Couldn't create cache directory: ");
+    return false;
+  }
+  return true;
+}
+
+bool cache_fingerprint(const char* file, run_fingerprint_t* fingerprint) {
+  memset(fingerprint, 0, sizeof(*fingerprint));
+
+  struct stat st;
+  if (stat(file, &st) == -1) {
+    perror("Couldn't stat the file: ");
+    return false;
+  }
+  fingerprint->path = realpath(file, NULL);
+  if (!fingerprint->path) {
+    perror("Couldn't resolve the file path: ");
+    return false;
+  }
+  fingerprint->dev = st.st_dev;
+  fingerprint->ino = st.st_ino;
+  fingerprint->size = st.st_size;
+  fingerprint->mtime = st.st_mtim;
+  return true;
+}
+
+void cache_free_fingerprint(run_fingerprint_t* fingerprint) {
+  free(fingerprint->path);
+  fingerprint->path = NULL;
+}
+
+static void fill_header(const run_fingerprint_t* fingerprint, struct cache_header_s* header) {
+  memset(header, 0, sizeof(*header));
+  header->magic = cache_magic;
+  header->version = cache_version;
+  header->path_length = strlen(fingerprint->path);
+  header->dev = fingerprint->dev;
+  header->ino = fingerprint->ino;
+  header->size = fingerprint->size;
+  header->mtime_sec = fingerprint->mtime.tv_sec;
+  header->mtime_nsec = fingerprint->mtime.tv_nsec;
+}
+
+bool cache_load_run(const char* cache_dir, const run_fingerprint_t* fingerprint, buffer_t* buffer) {
+  char path[PATH_MAX];
+  if (!run_path(cache_dir, fingerprint, path, sizeof(path))) {
+    return false;
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct cache_header_s expected, header;
+  fill_header(fingerprint, &expected);
+  bool ok = read_full(fd, &header, sizeof(header));
+  expected.count = header.count;
+  expected.checksum = header.checksum;
+  ok = ok && !memcmp(&header, &expected, sizeof(header));
+
+  char* stored_path = NULL;
+  if (ok) {
+    stored_path = malloc(header.path_length);
+    ok = stored_path && read_full(fd, stored_path, header.path_length)
+        && !memcmp(stored_path, fingerprint->path, header.path_length);
+    free(stored_path);
+  }
+
+  int* values = NULL;
+  if (ok) {
+    values = reallocarray(NULL, header.count ? header.count : 1, sizeof(int));
+    ok = values != NULL;
+  }
+  if (ok) {
+    packed_reader_t reader;
+    ok = packed_reader_open(&reader, fd, (off_t)(sizeof(header) + header.path_length))
+        && reader.count == header.count;
+    size_t decoded = 0;
+    while (ok && decoded < header.count) {
+      ssize_t count = packed_reader_next_block(&reader, values + decoded);
+      ok = count > 0;
+      decoded += ok ? count : 0;
+    }
+    packed_reader_close(&reader);
+    ok = ok && hash_run(values, header.count) == header.checksum;
+  }
+  close(fd);
+
+  if (!ok) {
+    free(values);
+    return false;
+  }
+  free(buffer->buf);
+  buffer->buf = values;
+  buffer->size = header.count;
+  return true;
+}
+
+bool cache_store_run(const char* cache_dir, const run_fingerprint_t* fingerprint, buffer_t buffer) {
+  char path[PATH_MAX];
+  char tmp_path[PATH_MAX];
+  if (!run_path(cache_dir, fingerprint, path, sizeof(path))) {
+    return false;
+  }
+  int ret = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+  if (ret < 0 || (size_t)ret >= sizeof(tmp_path)) {
+    return false;
+  }
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    perror("Couldn't create cache file: ");
+    return false;
+  }
+
+  struct cache_header_s header;
+  fill_header(fingerprint, &header);
+  header.count = buffer.size;
+  header.checksum = hash_run(buffer.buf, buffer.size);
+
+  bool ok = write_full(fd, &header, sizeof(header))
+      && write_full(fd, fingerprint->path, header.path_length)
+      && packed_write(fd, buffer.buf, buffer.size);
+  ok = (close(fd) == 0) && ok;
+  if (ok && rename(tmp_path, path) == -1) {
+    ok = false;
+  }
+  if (!ok) {
+    perror("Couldn't store sorted run to cache: ");
+    unlink(tmp_path);
+  }
+  return ok;
+}
@@ -0,0 +1,40 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_CACHE_H
+#define TASK1_CACHE_H
+
+#include "support.h"
+
+#include <sys/stat.h>
+
+// Identity of an input file. A cached sorted run is valid only while all of these fields stay the same.
+typedef struct {
+  char* path;
+
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+} run_fingerprint_t;
+
+// Creates cache_dir, if it doesn't exist yet.
+// Returns false in case of any error.
+bool cache_prepare_dir(const char* cache_dir);
+
+// Fills fingerprint of the file. Should be taken before the file is read, so a concurrent change invalidates the run.
+// Returns false in case of any error.
+bool cache_fingerprint(const char* file, run_fingerprint_t* fingerprint);
+void cache_free_fingerprint(run_fingerprint_t* fingerprint);
+
+// Loads the sorted run of the fingerprinted file into buffer.
+// Returns false if there is no valid run in the cache. Stale or corrupted runs are ignored.
+bool cache_load_run(const char* cache_dir, const run_fingerprint_t* fingerprint, buffer_t* buffer);
+
+// Stores the sorted buffer as the run of the fingerprinted file. The run is written to a temporary file first
+// and then renamed, so concurrent readers never see a partial run.
+// Returns false in case of any error. Failing to store a run isn't fatal for sorting.
+bool cache_store_run(const char* cache_dir, const run_fingerprint_t* fingerprint, buffer_t buffer);
+
+#endif //TASK1_CACHE_H
@@ -4,32 +4,126 @@
 
 #include "coroutine.h"
 #include "scheduler_internal.h"
+#include "parallel_parse.h"
+#include "cache.h"
+#include "packed_run.h"
+
+#include <memory.h>
+#include <stdio.h>
+
+struct chunked_read_s {
+  int_parser_t parser;
+
+  bool first_chunk;
+  // Packed runs are gathered whole and decoded at the end.
+  bool is_packed;
+  char* bytes;
+  size_t size;
+  size_t capacity;
+};
+
+static bool consume_chunk(void* ctx, const char* bytes, size_t size) {
+  struct chunked_read_s* read = ctx;
+  if (read->first_chunk) {
+    read->first_chunk = false;
+    read->is_packed = packed_is_packed(bytes, size);
+  }
+  if (!read->is_packed) {
+    return int_parser_feed(&read->parser, bytes, size);
+  }
+
+  if (read->size + size > read->capacity) {
+    size_t capacity = (read->capacity ? read->capacity * 2 : io_chunk_size * 2);
+    while (capacity < read->size + size) {
+      capacity *= 2;
+    }
+    char* new_bytes = realloc(read->bytes, capacity);
+    if (!new_bytes) {
+      perror("Couldn't allocate memory: ");
+      return false;
+    }
+    read->bytes = new_bytes;
+    read->capacity = capacity;
+  }
+  memcpy(read->bytes + read->size, bytes, size);
+  read->size += size;
+  return true;
+}
+
+static bool read_buffer_chunked(const char* file, enum IO_MODE io_mode, buffer_t* buffer, bool* is_sorted) {
+  struct chunked_read_s read;
+  memset(&read, 0, sizeof(read));
+  read.first_chunk = true;
+  buffer->size = 0;
+  int_parser_init(&read.parser, buffer);
+
+  bool ok = scheduler_coro_read_file_chunked(file, io_mode, consume_chunk, &read);
+  if (ok && read.is_packed) {
+    ok = packed_decode(read.bytes, read.size, buffer);
+  } else if (ok) {
+    ok = int_parser_finish(&read.parser);
+  }
+  *is_sorted = read.is_packed;
+  free(read.bytes);
+  return ok;
+}
+
+bool read_buffer_async(const char *file, enum IO_MODE io_mode, buffer_t *buffer, bool *is_sorted) {
+  if (io_mode != CachedIO) {
+    return read_buffer_chunked(file, io_mode, buffer, is_sorted);
+  }
 
-bool read_buffer_async(const char *file, buffer_t *buffer) {
   char* bytes = NULL;
-  if (!scheduler_coro_read_file(file, &bytes)) {
+  size_t size = 0;
+  if (!scheduler_coro_read_file(file, &bytes, &size)) {
     return false;
   }
 
-  bool status = bytes_to_buffer(bytes, buffer);
+  bool status;
+  *is_sorted = packed_is_packed(bytes, size);
+  if (*is_sorted) {
+    status = packed_decode(bytes, size, buffer);
+  } else {
+    // Large files are parsed by all cores, so a single huge input doesn't serialize the whole run.
+    status = bytes_to_buffer_parallel(bytes, size, buffer);
+  }
   free(bytes);
   return status;
 }
 
 void coro_sort_file(void *ctx) {
-  struct {
-    const char* filename;
-    buffer_t* buffer;
-  }* var = ctx;
+  sort_task_t* task = ctx;
 
-  bool ok = read_buffer_async(var->filename, var->buffer);
+  // The fingerprint is taken before reading, so a file changed in the middle of the run isn't cached as unchanged.
+  run_fingerprint_t fingerprint;
+  bool use_cache = task->cache_dir && cache_fingerprint(task->filename, &fingerprint);
+  if (use_cache && cache_load_run(task->cache_dir, &fingerprint, task->buffer)) {
+    fprintf(stderr, "%s: sorted run loaded from cache\n", task->filename);
+    query_reduce_run(task->query, task->buffer, true);
+    cache_free_fingerprint(&fingerprint);
+    free(task);
+    return;
+  }
+
+  bool is_sorted = false;
+  bool ok = read_buffer_async(task->filename, task->query->io_mode, task->buffer, &is_sorted);
 
   if (!ok) {
+    if (use_cache) {
+      cache_free_fingerprint(&fingerprint);
+    }
     scheduler_coro_fail();
     return;
   }
 
-  sort_buffer(*var->buffer);
+  query_reduce_run(task->query, task->buffer, is_sorted);
 
-  free(var);
+  if (use_cache) {
+    // Only complete sorted runs are worth caching.
+    if (task->query->mode == FullSort) {
+      cache_store_run(task->cache_dir, &fingerprint, *task->buffer);
+    }
+    cache_free_fingerprint(&fingerprint);
+  }
+  free(task);
 }
@@ -8,12 +8,28 @@
 #include "support.h"
 #include "sort.h"
 #include "scheduler.h"
+#include "query.h"
 
 // Asynchronous read from file.
 // Needs to be run inside the coroutine.
 // Blocks the coroutine and switches execution to the scheduler.
-bool read_buffer_async(const char* file, buffer_t* buffer);
+// Files in the packed format are decoded instead of parsed. They are sorted already, which is reported by is_sorted.
+// With CachedIO the whole file is read at once and parsed in parallel. Otherwise it is read by chunks,
+// and every chunk is parsed while the next one is being read.
+bool read_buffer_async(const char* file, enum IO_MODE io_mode, buffer_t* buffer, bool* is_sorted);
 
+// Context of coro_sort_file. It is freed by the coroutine.
+typedef struct sort_task_s {
+  const char* filename;
+  buffer_t* buffer;
+
+  // Directory with cached sorted runs. NULL, if caching is disabled.
+  const char* cache_dir;
+
+  const query_t* query;
+} sort_task_t;
+
+// Reads the file from task into its buffer and reduces it according to the query (sorts it, by default).
 void coro_sort_file(void* ctx);
 
 #endif //TASK1_COROUTINE_H
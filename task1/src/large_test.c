@@ -0,0 +1,105 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "large_test.h"
+#include "sort.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#define large_test_run_count 3
+// Every run ends with the values 1, ..., large_test_tail_size.
+#define large_test_tail_size 4096
+
+static bool map_run(buffer_t* run, size_t size) {
+  void* mapping = mmap(NULL, size * sizeof(int), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                       -1, 0);
+  if (mapping == MAP_FAILED) {
+    perror("Couldn't map a run: ");
+    return false;
+  }
+  run->buf = mapping;
+  run->size = size;
+  for (size_t i = 0; i < large_test_tail_size; ++i) {
+    run->buf[size - large_test_tail_size + i] = (int)(i + 1);
+  }
+  return true;
+}
+
+static bool check_counting_merge(buffer_t* runs, size_t zero_count) {
+  buffer_t out = {.size = 0, .buf = NULL};
+  size_t* counts = NULL;
+  if (!merge_sorted_buffers_unique(runs, large_test_run_count, &out, &counts)) {
+    return false;
+  }
+  bool ok = out.size == large_test_tail_size + 1 && out.buf[0] == 0 && counts[0] == zero_count;
+  for (size_t i = 1; ok && i < out.size; ++i) {
+    ok = out.buf[i] == (int)i && counts[i] == large_test_run_count;
+  }
+  printf("counting merge: %zu distinct values, %zu zeros: %s\n", out.size, out.size ? counts[0] : 0,
+         ok ? "ok" : "FAILED");
+  free(out.buf);
+  free(counts);
+  return ok;
+}
+
+// The full merge output is checked window by window, so it never has to fit in memory.
+#define large_test_window_size ((size_t)1 << 20)
+
+typedef struct full_merge_check_s {
+  size_t zero_count;
+  size_t checked;
+} full_merge_check_t;
+
+static bool check_window(const int* values, size_t count, void* ctx) {
+  full_merge_check_t* check = ctx;
+  for (size_t j = 0; j < count; ++j) {
+    size_t i = check->checked + j;
+    int expected = i < check->zero_count ? 0 : (int)((i - check->zero_count) / large_test_run_count + 1);
+    if (values[j] != expected) {
+      fprintf(stderr, "full merge: value %zu is %d instead of %d\n", i, values[j], expected);
+      return false;
+    }
+  }
+  check->checked += count;
+  return true;
+}
+
+static bool check_full_merge(buffer_t* runs, size_t count, size_t zero_count) {
+  full_merge_check_t check = {.zero_count = zero_count, .checked = 0};
+  bool ok = merge_sorted_buffers_streamed(runs, large_test_run_count, large_test_window_size, check_window, &check);
+  ok = ok && check.checked == count;
+  printf("full merge: %zu values: %s\n", check.checked, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+bool large_test_run(size_t count) {
+  if (count < large_test_run_count * large_test_tail_size) {
+    fprintf(stderr, "At least %d values are needed.\n", large_test_run_count * large_test_tail_size);
+    return false;
+  }
+  buffer_t runs[large_test_run_count];
+  size_t mapped = 0;
+  bool ok = true;
+  for (int i = 0; i < large_test_run_count && ok; ++i) {
+    // The last run takes the remainder, so the sizes differ.
+    size_t size = (i == large_test_run_count - 1) ? count - count / large_test_run_count * i
+                                                  : count / large_test_run_count;
+    ok = map_run(&runs[i], size);
+    if (ok) {
+      ++mapped;
+    }
+  }
+
+  size_t zero_count = count - large_test_run_count * large_test_tail_size;
+  printf("%" PRIu64 " values in %d runs\n", (uint64_t)count, large_test_run_count);
+  ok = ok && check_counting_merge(runs, zero_count);
+  ok = ok && check_full_merge(runs, count, zero_count);
+
+  for (size_t i = 0; i < mapped; ++i) {
+    munmap(runs[i].buf, runs[i].size * sizeof(int));
+  }
+  return ok;
+}
@@ -0,0 +1,20 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_LARGE_TEST_H
+#define TASK1_LARGE_TEST_H
+
+#include "support.h"
+
+// Default amount of values: past 2^32, so that any 32-bit count or index in the merges wraps around.
+#define large_test_default_count ((size_t)4600000000ULL)
+
+// Checks the merges over synthetic runs holding count values in total.
+// The runs are sparse anonymous mappings: zeros, which are never written, followed by a short written tail, so
+// billions of values take a few megabytes of memory. The full merge is streamed through a small window, so both merges
+// are always checked.
+// Every result is compared with the exactly known expected one. Returns false if any check failed.
+bool large_test_run(size_t count);
+
+#endif //TASK1_LARGE_TEST_H
@@ -0,0 +1,219 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "packed_run.h"
+
+#include <memory.h>
+#include <stdio.h>
+
+#define block_header_size (3 * sizeof(uint32_t))
+// Worst case: every delta takes 5 bytes.
+#define max_block_size (block_header_size + (packed_block_values - 1) * 5)
+// Encoded bytes are written and read by chunks of about this size.
+#define packed_chunk_size (256 * 1024)
+
+bool packed_is_packed(const char* bytes, size_t size) {
+  return size >= packed_header_size && !memcmp(bytes, packed_magic, packed_magic_size);
+}
+
+static size_t encode_block(const int* values, uint32_t count, uint8_t* out) {
+  uint8_t* ptr = out + block_header_size;
+  for (uint32_t i = 1; i < count; ++i) {
+    uint32_t delta = (uint32_t)values[i] - (uint32_t)values[i - 1];
+    while (delta >= 0x80) {
+      *ptr++ = (uint8_t)(delta | 0x80);
+      delta >>= 7;
+    }
+    *ptr++ = (uint8_t)delta;
+  }
+  uint32_t header[3] = {count, (uint32_t)values[0], (uint32_t)(ptr - out - block_header_size)};
+  memcpy(out, header, sizeof(header));
+  return ptr - out;
+}
+
+// Decodes a block from in[0, size). Returns the amount of consumed bytes, or 0 if the block is damaged.
+static size_t decode_block(const uint8_t* in, size_t size, int* out, uint32_t* count) {
+  uint32_t header[3];
+  if (size < block_header_size) {
+    return 0;
+  }
+  memcpy(header, in, sizeof(header));
+  if (header[0] == 0 || header[0] > packed_block_values || header[2] > size - block_header_size) {
+    return 0;
+  }
+
+  const uint8_t* ptr = in + block_header_size;
+  const uint8_t* end = ptr + header[2];
+  int val = (int)header[1];
+  out[0] = val;
+  for (uint32_t i = 1; i < header[0]; ++i) {
+    uint32_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+      if (ptr == end || shift > 28) {
+        return 0;
+      }
+      byte = *ptr++;
+      delta |= (uint32_t)(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    // The run has to stay sorted, so a delta may not go past INT_MAX.
+    if ((int64_t)val + delta > INT32_MAX) {
+      return 0;
+    }
+    val = (int)((int64_t)val + delta);
+    out[i] = val;
+  }
+  if (ptr != end) {
+    return 0;
+  }
+  *count = header[0];
+  return block_header_size + header[2];
+}
+
+bool packed_write(int fd, const int* values, size_t count) {
+  uint8_t* out = malloc(packed_chunk_size + max_block_size);
+  if (!out) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  memcpy(out, packed_magic, packed_magic_size);
+  uint64_t count64 = count;
+  memcpy(out + packed_magic_size, &count64, sizeof(count64));
+  size_t out_size = packed_header_size;
+
+  bool ok = true;
+  for (size_t i = 0; i < count && ok; i += packed_block_values) {
+    uint32_t block_count = (count - i < packed_block_values) ? (uint32_t)(count - i) : packed_block_values;
+    out_size += encode_block(values + i, block_count, out + out_size);
+    if (out_size >= packed_chunk_size) {
+      ok = write_full(fd, out, out_size);
+      out_size = 0;
+    }
+  }
+  ok = ok && write_full(fd, out, out_size);
+  if (!ok) {
+    perror("Couldn't write packed run: ");
+  }
+  free(out);
+  return ok;
+}
+
+bool packed_decode(const char* bytes, size_t size, buffer_t* buffer) {
+  if (!packed_is_packed(bytes, size)) {
+    fprintf(stderr, "Not a packed run.\n");
+    return false;
+  }
+  uint64_t count;
+  memcpy(&count, bytes + packed_magic_size, sizeof(count));
+
+  int* values = reallocarray(buffer->buf, count ? count : 1, sizeof(int));
+  if (!values) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  buffer->buf = values;
+  buffer->size = 0;
+
+  const uint8_t* ptr = (const uint8_t*)bytes + packed_header_size;
+  const uint8_t* end = (const uint8_t*)bytes + size;
+  while (buffer->size < count) {
+    uint32_t block_count = 0;
+    // The last block may not hold more values than the header promised.
+    if (count - buffer->size < packed_block_values) {
+      int tail[packed_block_values];
+      size_t consumed = decode_block(ptr, end - ptr, tail, &block_count);
+      if (!consumed || block_count != count - buffer->size) {
+        fprintf(stderr, "Packed run is damaged.\n");
+        return false;
+      }
+      memcpy(values + buffer->size, tail, block_count * sizeof(int));
+      ptr += consumed;
+    } else {
+      size_t consumed = decode_block(ptr, end - ptr, values + buffer->size, &block_count);
+      if (!consumed) {
+        fprintf(stderr, "Packed run is damaged.\n");
+        return false;
+      }
+      ptr += consumed;
+    }
+    // Blocks are checked one by one, so check the order between them too.
+    if (buffer->size && values[buffer->size - 1] > values[buffer->size]) {
+      fprintf(stderr, "Packed run is damaged.\n");
+      return false;
+    }
+    buffer->size += block_count;
+  }
+  return true;
+}
+
+bool packed_reader_open(packed_reader_t* reader, int fd, off_t offset) {
+  memset(reader, 0, sizeof(*reader));
+  char header[packed_header_size];
+  if (pread(fd, header, sizeof(header), offset) != (ssize_t)sizeof(header)
+      || !packed_is_packed(header, sizeof(header))) {
+    fprintf(stderr, "Not a packed run.\n");
+    return false;
+  }
+  reader->bytes = malloc(packed_chunk_size);
+  if (!reader->bytes) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  memcpy(&reader->count, header + packed_magic_size, sizeof(reader->count));
+  reader->fd = fd;
+  reader->offset = offset + (off_t)packed_header_size;
+  return true;
+}
+
+void packed_reader_close(packed_reader_t* reader) {
+  free(reader->bytes);
+  reader->bytes = NULL;
+}
+
+// Makes sure, that at least size bytes are read ahead.
+static bool read_ahead(packed_reader_t* reader, size_t size) {
+  while (reader->bytes_size - reader->bytes_pos < size) {
+    memmove(reader->bytes, reader->bytes + reader->bytes_pos, reader->bytes_size - reader->bytes_pos);
+    reader->bytes_size -= reader->bytes_pos;
+    reader->bytes_pos = 0;
+
+    ssize_t bytes_read = pread(reader->fd, reader->bytes + reader->bytes_size, packed_chunk_size - reader->bytes_size,
+                               reader->offset);
+    if (bytes_read <= 0) {
+      return false;
+    }
+    reader->offset += bytes_read;
+    reader->bytes_size += bytes_read;
+  }
+  return true;
+}
+
+ssize_t packed_reader_next_block(packed_reader_t* reader, int* out) {
+  if (reader->decoded == reader->count) {
+    return 0;
+  }
+  uint32_t header[3];
+  if (!read_ahead(reader, block_header_size)) {
+    fprintf(stderr, "Packed run is truncated.\n");
+    return -1;
+  }
+  memcpy(header, reader->bytes + reader->bytes_pos, sizeof(header));
+  if (header[2] > max_block_size - block_header_size || !read_ahead(reader, block_header_size + header[2])) {
+    fprintf(stderr, "Packed run is damaged.\n");
+    return -1;
+  }
+
+  uint32_t count = 0;
+  size_t consumed = decode_block(reader->bytes + reader->bytes_pos, reader->bytes_size - reader->bytes_pos, out,
+                                 &count);
+  if (!consumed || count > reader->count - reader->decoded) {
+    fprintf(stderr, "Packed run is damaged.\n");
+    return -1;
+  }
+  reader->bytes_pos += consumed;
+  reader->decoded += count;
+  return count;
+}
@@ -0,0 +1,59 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_PACKED_RUN_H
+#define TASK1_PACKED_RUN_H
+
+#include "support.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Compact binary format of sorted runs.
+//
+// A run starts with a header: 8 bytes of magic and the 8 byte amount of values. Then blocks of up to
+// packed_block_values values follow. Each block is the 4 byte amount of values, the first value and the 4 byte size
+// of the payload, followed by the payload itself: the deltas between successive values, encoded as varints.
+// Deltas of sorted values are never negative and usually small, so most of them take a single byte.
+
+#define packed_magic "SRTPACK1"
+#define packed_magic_size 8
+#define packed_header_size (packed_magic_size + sizeof(uint64_t))
+#define packed_block_values 1024
+
+// Checks if bytes start with a packed run header.
+bool packed_is_packed(const char* bytes, size_t size);
+
+// Writes the sorted values to fd as a packed run, starting at the current offset.
+// Returns false in case of any error.
+bool packed_write(int fd, const int* values, size_t count);
+
+// Decodes the whole packed run from memory into buffer.
+// Returns false in case of any error or a damaged run.
+bool packed_decode(const char* bytes, size_t size, buffer_t* buffer);
+
+// Streaming decoder of a packed run, stored in a file.
+typedef struct {
+  int fd;
+  off_t offset;
+
+  uint64_t count;
+  uint64_t decoded;
+
+  // Read-ahead of the encoded bytes.
+  uint8_t* bytes;
+  size_t bytes_size;
+  size_t bytes_pos;
+} packed_reader_t;
+
+// Reads the run header at offset of fd. The fd is read with pread, so its offset isn't changed.
+// Returns false in case of any error.
+bool packed_reader_open(packed_reader_t* reader, int fd, off_t offset);
+void packed_reader_close(packed_reader_t* reader);
+
+// Decodes the next block into out, which should have room for packed_block_values values.
+// Returns the amount of decoded values, 0 at the end of the run, or -1 in case of any error.
+ssize_t packed_reader_next_block(packed_reader_t* reader, int* out);
+
+#endif //TASK1_PACKED_RUN_H
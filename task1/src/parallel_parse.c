@@ -0,0 +1,122 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "parallel_parse.h"
+
+#include <ctype.h>
+#include <memory.h>
+#include <pthread.h>
+#include <stdio.h>
+
+struct parse_chunk_s {
+  char* bytes;
+  buffer_t result;
+  bool ok;
+  // Parsing stopped at a token, which isn't a number, before the end of the chunk.
+  bool stopped;
+
+  bool threaded;
+  pthread_t thread;
+};
+
+static void* parse_chunk(void* ctx) {
+  struct parse_chunk_s* chunk = ctx;
+  char* end;
+  chunk->ok = bytes_to_buffer_until(chunk->bytes, &chunk->result, &end);
+  while (isspace((unsigned char)*end)) {
+    ++end;
+  }
+  chunk->stopped = *end != '\0';
+  return NULL;
+}
+
+static int parse_thread_count(size_t size) {
+  long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpu_count < 1) {
+    cpu_count = 1;
+  }
+  size_t by_size = size / parallel_parse_min_chunk;
+  if (by_size < (size_t)cpu_count) {
+    cpu_count = (long)by_size;
+  }
+  if (cpu_count > parallel_parse_max_threads) {
+    cpu_count = parallel_parse_max_threads;
+  }
+  return (int)cpu_count;
+}
+
+// Splits bytes into at most chunk_count chunks. Each chunk ends right before a whitespace, which is replaced with '\0',
+// so no number is cut in two. Returns the actual amount of chunks.
+static int split_to_chunks(char* bytes, size_t size, struct parse_chunk_s* chunks, int chunk_count) {
+  size_t begin = 0;
+  int count = 0;
+  for (int i = 0; i < chunk_count && begin < size; ++i) {
+    size_t end = (i == chunk_count - 1) ? size : size / chunk_count * (i + 1);
+    if (end < begin) {
+      end = begin;
+    }
+    while (end < size && !isspace((unsigned char)bytes[end])) {
+      ++end;
+    }
+    bytes[end] = '\0';
+
+    memset(&chunks[count], 0, sizeof(chunks[count]));
+    chunks[count].bytes = bytes + begin;
+    ++count;
+    begin = end + 1;
+  }
+  return count;
+}
+
+bool bytes_to_buffer_parallel(char* bytes, size_t size, buffer_t* buffer) {
+  int thread_count = parse_thread_count(size);
+  if (thread_count <= 1) {
+    return bytes_to_buffer(bytes, buffer);
+  }
+
+  struct parse_chunk_s chunks[parallel_parse_max_threads];
+  int chunk_count = split_to_chunks(bytes, size, chunks, thread_count);
+
+  // The first chunk is parsed by the calling thread. If a thread couldn't be spawned, its chunk is parsed inline too.
+  for (int i = 1; i < chunk_count; ++i) {
+    chunks[i].threaded = pthread_create(&chunks[i].thread, NULL, parse_chunk, &chunks[i]) == 0;
+  }
+  parse_chunk(&chunks[0]);
+  for (int i = 1; i < chunk_count; ++i) {
+    if (chunks[i].threaded) {
+      pthread_join(chunks[i].thread, NULL);
+    } else {
+      parse_chunk(&chunks[i]);
+    }
+  }
+
+  // The serial parser stops at the first token, which isn't a number, so the chunks after it are dropped.
+  int taken_count = 0;
+  while (taken_count < chunk_count && !chunks[taken_count++].stopped) {
+  }
+
+  bool ok = true;
+  size_t all_size = 0;
+  for (int i = 0; i < taken_count; ++i) {
+    ok = ok && chunks[i].ok;
+    all_size += chunks[i].result.size;
+  }
+
+  if (ok) {
+    buffer->buf = reallocarray(buffer->buf, all_size ? all_size : 1, sizeof(int));
+    if (!buffer->buf) {
+      perror("Couldn't allocate memory: ");
+      ok = false;
+    }
+  }
+  buffer->size = 0;
+  for (int i = 0; i < chunk_count; ++i) {
+    if (ok && i < taken_count) {
+      memcpy(buffer->buf + buffer->size, chunks[i].result.buf, chunks[i].result.size * sizeof(int));
+      buffer->size += chunks[i].result.size;
+    }
+    free(chunks[i].result.buf);
+  }
+  return ok;
+}
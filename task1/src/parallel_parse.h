@@ -0,0 +1,20 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_PARALLEL_PARSE_H
+#define TASK1_PARALLEL_PARSE_H
+
+#include "support.h"
+
+// Minimal amount of bytes a single parsing thread gets. Smaller inputs are parsed in the calling thread.
+#define parallel_parse_min_chunk (1024 * 1024)
+#define parallel_parse_max_threads 64
+
+// Same as bytes_to_buffer, but splits bytes[0, size) at whitespace boundaries and parses the chunks on worker threads.
+// Chunk results are concatenated into buffer in the original order.
+// Expects bytes[size] to be '\0'. Whitespaces at the split points are overwritten with '\0'.
+// Returns false in case of any error.
+bool bytes_to_buffer_parallel(char* bytes, size_t size, buffer_t* buffer);
+
+#endif //TASK1_PARALLEL_PARSE_H
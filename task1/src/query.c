@@ -0,0 +1,194 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "query.h"
+#include "sort.h"
+#include "packed_run.h"
+
+#include <math.h>
+#include <memory.h>
+#include <stdio.h>
+
+static const double default_quantiles[] = {0, 0.25, 0.5, 0.75, 1};
+
+bool query_parse_quantiles(const char* list, query_t* query) {
+  query->quantile_count = 0;
+  if (!list) {
+    query->quantile_count = sizeof(default_quantiles) / sizeof(default_quantiles[0]);
+    memcpy(query->quantiles, default_quantiles, sizeof(default_quantiles));
+    return true;
+  }
+
+  const char* ptr = list;
+  while (*ptr) {
+    char* end;
+    double val = strtod(ptr, &end);
+    if (end == ptr || val < 0 || val > 1 || query->quantile_count == max_quantile_count) {
+      fprintf(stderr, "Invalid quantile list: %s\n", list);
+      return false;
+    }
+    query->quantiles[query->quantile_count++] = val;
+    ptr = end;
+    if (*ptr == ',') {
+      ++ptr;
+    } else if (*ptr) {
+      fprintf(stderr, "Invalid quantile list: %s\n", list);
+      return false;
+    }
+  }
+  return query->quantile_count > 0;
+}
+
+// Moves the last k values to the front and shrinks the buffer to them.
+static void keep_tail(buffer_t* buffer, size_t k) {
+  memmove(buffer->buf, buffer->buf + buffer->size - k, k * sizeof(int));
+  buffer->size = k;
+}
+
+void query_reduce_run(const query_t* query, buffer_t* buffer, bool is_sorted) {
+  switch (query->mode) {
+    case FullSort:
+      if (!is_sorted) {
+        sort_buffer(*buffer);
+      }
+      break;
+    case BottomK:
+      if (buffer->size > query->k) {
+        if (!is_sorted) {
+          select_nth(buffer->buf, buffer->size, query->k);
+        }
+        buffer->size = query->k;
+      }
+      if (!is_sorted) {
+        sort_buffer(*buffer);
+      }
+      break;
+    case TopK:
+      if (buffer->size > query->k) {
+        if (!is_sorted && query->k) {
+          select_nth(buffer->buf, buffer->size, buffer->size - query->k);
+        }
+        keep_tail(buffer, query->k);
+      }
+      if (!is_sorted) {
+        sort_buffer(*buffer);
+      }
+      break;
+    case Quantiles:
+      break;
+  }
+}
+
+// Copies all the values into one newly allocated buffer. The inputs may be read-only mappings, so they stay intact.
+static bool concat_buffers(const buffer_t* in_buffers, int in_buf_count, buffer_t* all) {
+  size_t all_size = 0;
+  for (int i = 0; i < in_buf_count; ++i) {
+    all_size += in_buffers[i].size;
+  }
+  all->buf = reallocarray(NULL, all_size ? all_size : 1, sizeof(int));
+  if (!all->buf) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  all->size = 0;
+  for (int i = 0; i < in_buf_count; ++i) {
+    memcpy(all->buf + all->size, in_buffers[i].buf, in_buffers[i].size * sizeof(int));
+    all->size += in_buffers[i].size;
+  }
+  return true;
+}
+
+static int compare_doubles(const void* lhs, const void* rhs) {
+  double a = *(const double*)lhs;
+  double b = *(const double*)rhs;
+  return (a > b) - (a < b);
+}
+
+static bool store_quantiles(const query_t* query, buffer_t* in_buffers, int in_buf_count, const char* filename) {
+  buffer_t all;
+  if (!concat_buffers(in_buffers, in_buf_count, &all)) {
+    return false;
+  }
+
+  FILE* f = fopen(filename, "w");
+  if (f == NULL) {
+    perror("Couldn't create file: ");
+    free(all.buf);
+    return false;
+  }
+  if (!all.size) {
+    free(all.buf);
+    fclose(f);
+    return true;
+  }
+
+  double quantiles[max_quantile_count];
+  memcpy(quantiles, query->quantiles, query->quantile_count * sizeof(double));
+  qsort(quantiles, query->quantile_count, sizeof(double), compare_doubles);
+
+  // Ranks are ascending, so every selection only has to look at the part after the previous rank.
+  size_t from = 0;
+  for (int i = 0; i < query->quantile_count; ++i) {
+    size_t rank = (size_t)llround(quantiles[i] * (double)(all.size - 1));
+    select_nth(all.buf + from, all.size - from, rank - from);
+    from = rank;
+    fprintf(f, "%g %d\n", quantiles[i], all.buf[rank]);
+  }
+  bool ok = !ferror(f);
+  if (!ok) {
+    fprintf(stderr, "Couldn't write to a file.");
+  }
+  free(all.buf);
+  fclose(f);
+  return ok;
+}
+
+static bool store_values(const query_t* query, buffer_t buffer, const char* filename) {
+  if (!query->packed_output) {
+    return store_buffer_to_file(buffer, filename, query->io_mode);
+  }
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    perror("Couldn't create file: ");
+    return false;
+  }
+  bool ok = packed_write(fd, buffer.buf, buffer.size);
+  return (close(fd) == 0) && ok;
+}
+
+static bool store_unique(const query_t* query, buffer_t* in_buffers, int in_buf_count, const char* filename) {
+  buffer_t out_buffer = {.size = 0, .buf = NULL};
+  size_t* counts = NULL;
+  bool with_counts = query->merge_mode == MergeCount;
+  if (!merge_sorted_buffers_unique(in_buffers, in_buf_count, &out_buffer, with_counts ? &counts : NULL)) {
+    return false;
+  }
+  bool ok = with_counts ? store_counts_to_file(out_buffer, counts, filename, query->io_mode)
+                        : store_values(query, out_buffer, filename);
+  free(counts);
+  free(out_buffer.buf);
+  return ok;
+}
+
+bool query_combine_and_store(const query_t* query, buffer_t* in_buffers, int in_buf_count, const char* filename) {
+  if (query->mode == Quantiles) {
+    return store_quantiles(query, in_buffers, in_buf_count, filename);
+  }
+  if (query->merge_mode != MergeAll) {
+    return store_unique(query, in_buffers, in_buf_count, filename);
+  }
+
+  buffer_t out_buffer = {.size = 0, .buf = NULL};
+  if (!merge_sorted_buffers(in_buffers, in_buf_count, &out_buffer)) {
+    return false;
+  }
+  if (query->mode == BottomK && out_buffer.size > query->k) {
+    out_buffer.size = query->k;
+  } else if (query->mode == TopK && out_buffer.size > query->k) {
+    keep_tail(&out_buffer, query->k);
+  }
+  bool ok = store_values(query, out_buffer, filename);
+  free(out_buffer.buf);
+  return ok;
+}
@@ -0,0 +1,61 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_QUERY_H
+#define TASK1_QUERY_H
+
+#include "support.h"
+
+enum QUERY_MODE {
+  FullSort,
+  BottomK,
+  TopK,
+  Quantiles,
+};
+
+// What the k-way merge of FullSort emits for runs of equal values.
+enum MERGE_MODE {
+  MergeAll,
+  // Every distinct value once.
+  MergeUnique,
+  // Every distinct value once, along with its multiplicity.
+  MergeCount,
+};
+
+#define max_quantile_count 64
+
+typedef struct {
+  enum QUERY_MODE mode;
+  enum MERGE_MODE merge_mode;
+
+  // Store sorted values in the packed format instead of text. Not applicable to counts and quantiles.
+  bool packed_output;
+  // How the inputs are read and the text output is written.
+  enum IO_MODE io_mode;
+
+  // Amount of values for BottomK and TopK.
+  size_t k;
+
+  // Requested quantiles for Quantiles mode, each in [0, 1].
+  double quantiles[max_quantile_count];
+  int quantile_count;
+} query_t;
+
+// Parses comma separated list of quantiles, like "0.5,0.9,0.99". NULL stands for min, quartiles and max.
+// Returns false in case of invalid list.
+bool query_parse_quantiles(const char* list, query_t* query);
+
+// Per-file part of a query. Should be run inside the coroutine, right after the file is read.
+// Sorts the buffer for FullSort. For BottomK and TopK keeps only k candidate values, sorted. Linear for these modes.
+// Quantiles are computed over the union of all inputs, so the buffer is left as is.
+// is_sorted tells, that the buffer is already sorted (e.g. loaded from cache).
+void query_reduce_run(const query_t* query, buffer_t* buffer, bool is_sorted);
+
+// Combines runs reduced by query_reduce_run and stores the answer to the file. The runs are only read.
+// FullSort and BottomK/TopK store the values; MergeCount stores "value count" lines; Quantiles store
+// "quantile value" lines.
+// Returns false in case of any error.
+bool query_combine_and_store(const query_t* query, buffer_t* in_buffers, int in_buf_count, const char* filename);
+
+#endif //TASK1_QUERY_H
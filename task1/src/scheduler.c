@@ -48,8 +48,9 @@ bool scheduler_add_task(void (*coroutine)(void *), void *ctx) {
   return true;
 }
 
-bool scheduler_initialize(int max_coro_count) {
+bool scheduler_initialize(int max_coro_count, bool is_quiet) {
   STAILQ_INIT(&scheduler_context.run_queue);
+  scheduler_context.is_quiet = is_quiet;
   scheduler_context.suspended_coro_count = 0;
   scheduler_context.last_coro_idx = 0;
   scheduler_context.max_coro_count = max_coro_count;
@@ -69,6 +70,14 @@ void scheduler_destroy() {
   free(scheduler_context.suspend_lst);
 }
 
+// Fills in, whom to wake up, once the request completes. It has to be done before the request is queued: an aiocb
+// mustn't be changed while its request is in flight.
+static void set_waiting_coro(struct aiocb* ctx) {
+  // Notifications aren't used, so the value is free to tell the scheduler, whom to wake up.
+  ctx->aio_sigevent.sigev_notify = SIGEV_NONE;
+  ctx->aio_sigevent.sigev_value.sival_ptr = scheduler_context.current_coro;
+}
+
 static void scheduler_submit_task_and_suspend(struct aiocb* ctx) {
   for (int i = 0; i < scheduler_context.max_coro_count; ++i) {
     if (scheduler_context.suspend_lst[i] == NULL) {
@@ -79,14 +88,15 @@ static void scheduler_submit_task_and_suspend(struct aiocb* ctx) {
   scheduler_coro_suspend();
 }
 
-bool scheduler_coro_read_file(const char *file, char **ptr_to_bytes) {
+bool scheduler_coro_read_file(const char *file, char **ptr_to_bytes, size_t *size) {
   ssize_t file_size = get_file_size(file);
 
   if (file_size == -1) {
     return false;
   }
 
-  char* bytes = malloc(file_size + sizeof(entity_t*));
+  // One extra byte for the terminating '\0'.
+  char* bytes = malloc(file_size + 1);
   if (!bytes) {
     perror("Couldn't allocate memory: ");
     return false;
@@ -96,6 +106,7 @@ bool scheduler_coro_read_file(const char *file, char **ptr_to_bytes) {
   int fd = open(file, O_RDONLY);
   if (fd == -1) {
     perror("Couldn't open a file: ");
+    free(bytes);
     return false;
   }
 
@@ -103,27 +114,144 @@ bool scheduler_coro_read_file(const char *file, char **ptr_to_bytes) {
   memset(&ctx, 0, sizeof(ctx));
   ctx.aio_nbytes = file_size;
   ctx.aio_fildes = fd;
-  ctx.aio_buf = bytes + sizeof(entity_t*);
-  // Some nasty things, because making proper work with aio and aio_suspend inside the scheduler would take a lot more time.
-  *((entity_t **)bytes) = scheduler_context.current_coro;
+  ctx.aio_buf = bytes;
+  set_waiting_coro(&ctx);
 
-  aio_read(&ctx);
+  if (aio_read(&ctx) == -1) {
+    perror("Couldn't start reading: ");
+    close(fd);
+    free(bytes);
+    return false;
+  }
 
   scheduler_submit_task_and_suspend(&ctx);
 
-  int status = aio_return(&ctx);
+  ssize_t status = aio_return(&ctx);
+  close(fd);
   if (status == -1) {
     perror("Read error: ");
     scheduler_coro_fail();
   }
 
-  // Shift array back.
-  memmove(bytes, bytes + sizeof(entity_t*), file_size);
-  bytes[file_size - 1] = 0;
+  bytes[status] = 0;
   *ptr_to_bytes = bytes;
+  *size = status;
+  return true;
+}
+
+struct chunk_read_s {
+  struct aiocb cb;
+  char* buf;
+  bool in_flight;
+};
+
+static bool submit_chunk_read(struct chunk_read_s* chunk, int fd, off_t offset) {
+  memset(&chunk->cb, 0, sizeof(chunk->cb));
+  chunk->cb.aio_fildes = fd;
+  chunk->cb.aio_buf = chunk->buf;
+  chunk->cb.aio_nbytes = io_chunk_size;
+  chunk->cb.aio_offset = offset;
+  set_waiting_coro(&chunk->cb);
+  if (aio_read(&chunk->cb) == -1) {
+    perror("Couldn't start reading: ");
+    return false;
+  }
+  chunk->in_flight = true;
   return true;
 }
 
+static ssize_t wait_chunk_read(struct chunk_read_s* chunk) {
+  if (aio_error(&chunk->cb) == EINPROGRESS) {
+    scheduler_submit_task_and_suspend(&chunk->cb);
+  }
+  chunk->in_flight = false;
+  return aio_return(&chunk->cb);
+}
+
+static int open_for_reading(const char* file, enum IO_MODE io_mode, bool* is_direct) {
+  *is_direct = false;
+  if (io_mode == DirectIO) {
+    int fd = open(file, O_RDONLY | O_DIRECT);
+    if (fd != -1) {
+      *is_direct = true;
+      return fd;
+    }
+    if (errno != EINVAL) {
+      perror("Couldn't open a file: ");
+      return -1;
+    }
+    fprintf(stderr, "%s: direct I/O isn't supported by the file system, reading through the page cache.\n", file);
+  }
+  int fd = open(file, O_RDONLY);
+  if (fd == -1) {
+    perror("Couldn't open a file: ");
+    return -1;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  return fd;
+}
+
+bool scheduler_coro_read_file_chunked(const char *file, enum IO_MODE io_mode,
+                                      bool (*on_chunk)(void *, const char *, size_t), void *ctx) {
+  bool is_direct;
+  int fd = open_for_reading(file, io_mode, &is_direct);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct chunk_read_s chunks[2];
+  memset(chunks, 0, sizeof(chunks));
+  bool ok = true;
+  for (int i = 0; i < 2 && ok; ++i) {
+    if (posix_memalign((void **) &chunks[i].buf, io_alignment, io_chunk_size) != 0) {
+      perror("Couldn't allocate memory: ");
+      ok = false;
+    }
+  }
+
+  off_t next_offset = 0;
+  for (int i = 0; i < 2 && ok; ++i) {
+    ok = submit_chunk_read(&chunks[i], fd, next_offset);
+    next_offset += io_chunk_size;
+  }
+
+  // While one chunk is consumed, the next one is being read. The loop goes on until both reads are collected,
+  // as the buffers can't be freed under a pending read.
+  bool done = !ok;
+  int current = 0;
+  while (chunks[current].in_flight) {
+    struct chunk_read_s* chunk = &chunks[current];
+    ssize_t bytes_read = wait_chunk_read(chunk);
+    if (bytes_read == -1) {
+      if (!done) {
+        perror("Read error: ");
+      }
+      ok = false;
+      done = true;
+    } else if (!done && bytes_read > 0) {
+      ok = on_chunk(ctx, chunk->buf, bytes_read);
+      if (io_mode == NoCacheIO && !is_direct) {
+        posix_fadvise(fd, chunk->cb.aio_offset, bytes_read, POSIX_FADV_DONTNEED);
+      }
+      // A short read means the end of file.
+      done = !ok || bytes_read < io_chunk_size;
+      if (!done) {
+        ok = submit_chunk_read(chunk, fd, next_offset);
+        next_offset += io_chunk_size;
+        done = !ok;
+      }
+    } else {
+      done = true;
+    }
+    current ^= 1;
+  }
+
+  free(chunks[0].buf);
+  free(chunks[1].buf);
+  close(fd);
+  return ok;
+}
+
 void scheduler_coro_enqueue(entity_t* entity) {
   STAILQ_INSERT_TAIL(&scheduler_context.run_queue, entity, entities);
 }
@@ -146,8 +274,7 @@ static bool scheduler_wait_any() {
       return false;
     } else {
       // Either it ended successfully reading from buffer, or an error happened. Let the coroutine decide, what to do with it.
-      entity_t** lst = (entity_t **) scheduler_context.suspend_lst[i]->aio_buf;
-      entity_t* entity = lst[-1];
+      entity_t* entity = scheduler_context.suspend_lst[i]->aio_sigevent.sigev_value.sival_ptr;
       scheduler_coro_enqueue(entity);
       scheduler_context.suspend_lst[i] = NULL;
     }
@@ -177,7 +304,9 @@ static bool check_state(entity_t* entity) {
   } else if (entity->status == Running) {
     // The coroutine has finished executing. Remove it and delete all of its data.
 
-    printf("Coroutine %d finished. Running time: %lfus\n", entity->idx, (double)entity->running_time * 1e6 / CLOCKS_PER_SEC);
+    if (!scheduler_context.is_quiet) {
+      printf("Coroutine %d finished. Running time: %lfus\n", entity->idx, (double)entity->running_time * 1e6 / CLOCKS_PER_SEC);
+    }
 
     munmap(entity->ctx.uc_stack.ss_sp, entity->ctx.uc_stack.ss_size);
     free(entity);
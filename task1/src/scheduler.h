@@ -12,7 +12,8 @@
 
 bool scheduler_add_task(void (*)(void *), void *ctx);
 
-bool scheduler_initialize(int max_coroutine_count);
+// is_quiet keeps the scheduler off stdout, which belongs to the caller of a library.
+bool scheduler_initialize(int max_coroutine_count, bool is_quiet);
 bool scheduler_run_loop();
 void scheduler_destroy();
 
@@ -46,6 +46,9 @@ struct scheduler_ctx_s {
   size_t max_coro_count;
 
   struct aiocb** suspend_lst;
+
+  // Finished coroutines aren't reported on stdout, e.g. when the scheduler runs inside the sorter library.
+  bool is_quiet;
 };
 
 // Coroutine API. Should be called only inside coroutines.
@@ -56,8 +59,16 @@ void scheduler_coro_yield();
 void scheduler_coro_suspend();
 // Non-returning call. Sets Coroutine status to Failed and switches to scheduler.
 void scheduler_coro_fail();
-// Call to read entire file, with blocking the coroutine
-bool scheduler_coro_read_file(const char* file, char** ptr_to_bytes);
+// Call to read entire file, with blocking the coroutine.
+// The returned bytes are '\0'-terminated, size holds the amount of bytes read.
+bool scheduler_coro_read_file(const char* file, char** ptr_to_bytes, size_t* size);
+// Call to read the file by io_chunk_size chunks, with blocking the coroutine only while the next chunk isn't read yet.
+// Two aligned buffers are used: one is being read into, while the other is passed to on_chunk. Chunks come in order.
+// DirectIO bypasses the page cache (falling back to it, if the file system doesn't support O_DIRECT).
+// NoCacheIO drops the consumed chunks from the page cache.
+// Reading stops, once on_chunk returns false. Returns false in case of any error.
+bool scheduler_coro_read_file_chunked(const char* file, enum IO_MODE io_mode,
+                                      bool (*on_chunk)(void* ctx, const char* bytes, size_t size), void* ctx);
 // ------------------------------------
 
 #endif //TASK1_SCHEDULER_INTERNAL_H
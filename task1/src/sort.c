@@ -6,16 +6,21 @@
 
 #include <limits.h>
 #include <memory.h>
+#include <stdint.h>
+#include <stdio.h>
 
-static void merge(int* left, const int* right, int size_left, int size_right) {
+// Distinct values are stored into buffers of this many values first.
+#define merge_unique_initial_capacity (64 * 1024)
+
+static void merge(int* left, const int* right, size_t size_left, size_t size_right) {
   int* buf = reallocarray(NULL, size_left + size_right, sizeof(int));
   if (!buf) {
       perror("Couldn't allocate memory");
       exit(1);
   }
 
-  int l = 0, r = 0;
-  int res_index = 0;
+  size_t l = 0, r = 0;
+  size_t res_index = 0;
   while (l < size_left && r < size_right) {
     if (left[l] < right[r]) {
       buf[res_index++] = left[l++];
@@ -34,12 +39,13 @@ static void merge(int* left, const int* right, int size_left, int size_right) {
 }
 
 
-static void sort_internal(int* ptr, int start, int end) {
-  if (start < end) {
-    int mid = start + (end - start) / 2;
+// Sorts ptr[start, end).
+static void sort_internal(int* ptr, size_t start, size_t end) {
+  if (end - start > 1) {
+    size_t mid = start + (end - start) / 2;
     sort_internal(ptr, start, mid);
-    sort_internal(ptr, mid + 1, end);
-    merge(&ptr[start], &ptr[mid + 1], mid - start + 1, end - mid);
+    sort_internal(ptr, mid, end);
+    merge(&ptr[start], &ptr[mid], mid - start, end - mid);
   }
 }
 
@@ -47,40 +53,281 @@ void sort_buffer(buffer_t buf) {
   if (!buf.size) {
     return;
   }
-  sort_internal(buf.buf, 0, buf.size - 1);
+  sort_internal(buf.buf, 0, buf.size);
 }
 
-bool merge_sorted_buffers(buffer_t *in_buffers, int in_buf_count, buffer_t *out_buf) {
-  int all_size = 0;
+static void swap_values(int* values, size_t i, size_t j) {
+  int tmp = values[i];
+  values[i] = values[j];
+  values[j] = tmp;
+}
+
+static int median_of_three(int a, int b, int c) {
+  if ((a <= b) == (b <= c)) {
+    return b;
+  }
+  if ((b <= a) == (a <= c)) {
+    return a;
+  }
+  return c;
+}
+
+static void insertion_sort(int* values, size_t size) {
+  for (size_t i = 1; i < size; ++i) {
+    int val = values[i];
+    size_t j = i;
+    while (j > 0 && values[j - 1] > val) {
+      values[j] = values[j - 1];
+      --j;
+    }
+    values[j] = val;
+  }
+}
+
+void select_nth(int* values, size_t size, size_t nth) {
+  size_t left = 0;
+  size_t right = size;
+  while (right - left > 16) {
+    int pivot = median_of_three(values[left], values[left + (right - left) / 2], values[right - 1]);
+
+    // Three-way partition: [left, lt) < pivot, [lt, gt) == pivot, [gt, right) > pivot.
+    // Keeps inputs with lots of duplicates linear.
+    size_t lt = left, i = left, gt = right;
+    while (i < gt) {
+      if (values[i] < pivot) {
+        swap_values(values, lt++, i++);
+      } else if (values[i] > pivot) {
+        swap_values(values, i, --gt);
+      } else {
+        ++i;
+      }
+    }
+    if (nth < lt) {
+      right = lt;
+    } else if (nth >= gt) {
+      left = gt;
+    } else {
+      return;
+    }
+  }
+  insertion_sort(values + left, right - left);
+}
+
+// Sums the sizes of the buffers. Returns false if the sum doesn't fit in size_t.
+static bool total_size(const buffer_t* in_buffers, int in_buf_count, size_t* all_size) {
+  *all_size = 0;
   for (int i = 0; i < in_buf_count; ++i) {
-    all_size += in_buffers[i].size;
+    if (in_buffers[i].size > SIZE_MAX - *all_size) {
+      fprintf(stderr, "Too many values to merge.\n");
+      return false;
+    }
+    *all_size += in_buffers[i].size;
+  }
+  return true;
+}
+
+// Writes up to out_size next values of the merge into out, advancing indices. Returns the number of values written.
+static size_t merge_next(const buffer_t* in_buffers, int in_buf_count, size_t* indices, int* out, size_t out_size) {
+  size_t current_out_index = 0;
+  while (current_out_index < out_size) {
+    int min_elem = INT_MAX;
+    int index = -1;
+    for (int i = 0; i < in_buf_count; ++i) {
+      if (indices[i] < in_buffers[i].size && (index == -1 || in_buffers[i].buf[indices[i]] < min_elem)) {
+        min_elem = in_buffers[i].buf[indices[i]];
+        index = i;
+      }
+    }
+    if (index == -1) {
+      break;
+    }
+    out[current_out_index++] = min_elem;
+    indices[index]++;
+  }
+  return current_out_index;
+}
+
+bool merge_sorted_buffers(buffer_t *in_buffers, int in_buf_count, buffer_t *out_buf) {
+  size_t all_size;
+  if (!total_size(in_buffers, in_buf_count, &all_size)) {
+    return false;
   }
   if (out_buf->size < all_size) {
-    out_buf->buf = reallocarray(out_buf->buf, all_size, sizeof(int));
-    if (out_buf->buf == NULL) {
+    int* buf = reallocarray(out_buf->buf, all_size, sizeof(int));
+    if (buf == NULL) {
       perror("Couldn't allocate buffer for merging: ");
       return false;
     }
+    out_buf->buf = buf;
     out_buf->size = all_size;
   }
 
-  int indices[in_buf_count];
-  for (int i = 0; i < in_buf_count; ++i) {
-    indices[i] = 0;
+  size_t* indices = calloc(in_buf_count ? in_buf_count : 1, sizeof(size_t));
+  if (!indices) {
+    perror("Couldn't allocate buffer for merging: ");
+    return false;
   }
+  merge_next(in_buffers, in_buf_count, indices, out_buf->buf, all_size);
+  free(indices);
+  return true;
+}
 
-  int current_out_index = 0;
-  while (current_out_index < all_size) {
-    int min_elem = INT_MAX;
+bool merge_sorted_buffers_streamed(buffer_t* in_buffers, int in_buf_count, size_t window_size,
+                                   merge_consumer_t consume, void* ctx) {
+  size_t all_size;
+  if (!total_size(in_buffers, in_buf_count, &all_size)) {
+    return false;
+  }
+  size_t* indices = calloc(in_buf_count ? in_buf_count : 1, sizeof(size_t));
+  int* window = malloc((window_size ? window_size : 1) * sizeof(int));
+  if (!indices || !window) {
+    perror("Couldn't allocate buffer for merging: ");
+    free(indices);
+    free(window);
+    return false;
+  }
+  bool ok = true;
+  for (size_t merged = 0; ok && merged < all_size;) {
+    size_t size = merge_next(in_buffers, in_buf_count, indices, window, window_size);
+    ok = size > 0 && consume(window, size, ctx);
+    merged += size;
+  }
+  free(indices);
+  free(window);
+  return ok;
+}
+
+// Returns the index right after the run of values equal to values[from].
+static size_t equal_run_end(const int* values, size_t from, size_t size) {
+  int val = values[from];
+  // Gallop until the run is bracketed, then binary search inside the last step.
+  size_t step = 1;
+  while (from + step < size && values[from + step] == val) {
+    step *= 2;
+  }
+  size_t lo = from + step / 2;
+  size_t hi = (from + step < size) ? from + step : size;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (values[mid] == val) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return hi;
+}
+
+// Makes sure, that out_buf and counts can hold one more value.
+static bool reserve_unique(buffer_t* out_buf, size_t** counts, size_t* capacity, size_t size, size_t all_size) {
+  if (size < *capacity) {
+    return true;
+  }
+  size_t new_capacity = *capacity * 2;
+  if (new_capacity > all_size) {
+    new_capacity = all_size;
+  }
+  int* buf = reallocarray(out_buf->buf, new_capacity, sizeof(int));
+  if (!buf) {
+    return false;
+  }
+  out_buf->buf = buf;
+  if (*counts) {
+    size_t* new_counts = reallocarray(*counts, new_capacity, sizeof(size_t));
+    if (!new_counts) {
+      return false;
+    }
+    *counts = new_counts;
+  }
+  *capacity = new_capacity;
+  return true;
+}
+
+// Frees the partially built output of a failed merge, so the caller gets nothing to free.
+static void free_unique_output(buffer_t* out_buf, size_t* counts) {
+  free(out_buf->buf);
+  out_buf->buf = NULL;
+  out_buf->size = 0;
+  free(counts);
+}
+
+bool merge_sorted_buffers_unique(buffer_t *in_buffers, int in_buf_count, buffer_t *out_buf, size_t **out_counts) {
+  size_t all_size;
+  if (!total_size(in_buffers, in_buf_count, &all_size)) {
+    return false;
+  }
+  // Distinct values are not counted beforehand, and heavily duplicated inputs hold far less of them than all_size,
+  // so the buffers grow on demand and are shrunk afterwards.
+  size_t capacity = all_size < merge_unique_initial_capacity ? all_size : merge_unique_initial_capacity;
+  if (!capacity) {
+    capacity = 1;
+  }
+  int* buf = reallocarray(out_buf->buf, capacity, sizeof(int));
+  if (buf) {
+    out_buf->buf = buf;
+  }
+  size_t* counts = NULL;
+  if (out_counts) {
+    counts = reallocarray(NULL, capacity, sizeof(size_t));
+  }
+  size_t* indices = calloc(in_buf_count ? in_buf_count : 1, sizeof(size_t));
+  if (buf == NULL || (out_counts && !counts) || !indices) {
+    perror("Couldn't allocate buffer for merging: ");
+    free_unique_output(out_buf, counts);
+    free(indices);
+    return false;
+  }
+
+  size_t out_size = 0;
+  while (true) {
     int index = -1;
     for (int i = 0; i < in_buf_count; ++i) {
-      if (indices[i] < in_buffers[i].size && in_buffers[i].buf[indices[i]] < min_elem) {
-        min_elem = in_buffers[i].buf[indices[i]];
+      if (indices[i] < in_buffers[i].size
+          && (index == -1 || in_buffers[i].buf[indices[i]] < in_buffers[index].buf[indices[index]])) {
         index = i;
       }
     }
-    out_buf->buf[current_out_index++] = min_elem;
-    indices[index]++;
+    if (index == -1) {
+      break;
+    }
+
+    int min_elem = in_buffers[index].buf[indices[index]];
+    size_t count = 0;
+    for (int i = index; i < in_buf_count; ++i) {
+      if (indices[i] < in_buffers[i].size && in_buffers[i].buf[indices[i]] == min_elem) {
+        size_t end = equal_run_end(in_buffers[i].buf, indices[i], in_buffers[i].size);
+        count += end - indices[i];
+        indices[i] = end;
+      }
+    }
+    if (!reserve_unique(out_buf, &counts, &capacity, out_size, all_size)) {
+      perror("Couldn't allocate buffer for merging: ");
+      free_unique_output(out_buf, counts);
+      free(indices);
+      return false;
+    }
+    out_buf->buf[out_size] = min_elem;
+    if (counts) {
+      counts[out_size] = count;
+    }
+    out_size++;
+  }
+  free(indices);
+
+  out_buf->size = out_size;
+  // Shrinking never fails in a way that matters: the old, larger buffer is kept.
+  int* shrunk_buf = reallocarray(out_buf->buf, out_size ? out_size : 1, sizeof(int));
+  if (shrunk_buf) {
+    out_buf->buf = shrunk_buf;
+  }
+  if (counts) {
+    size_t* shrunk_counts = reallocarray(counts, out_size ? out_size : 1, sizeof(size_t));
+    if (shrunk_counts) {
+      counts = shrunk_counts;
+    }
+  }
+  if (out_counts) {
+    *out_counts = counts;
   }
   return true;
 }
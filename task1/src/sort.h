@@ -11,9 +11,29 @@
 // Expects buf to be allocated. Sorts it in ascending order.
 void sort_buffer(buffer_t buf);
 
+// Reorders values, so that values[nth] is the element, which would be there if values were sorted.
+// All the elements before it are not greater, and all the elements after it are not less than values[nth].
+// Runs in O(size) on average.
+void select_nth(int* values, size_t size, size_t nth);
+
 // Checks if out_buf is allocated. If yes, and if there is enough memory to hold all input_buffers, then fits data in it.
 // Otherwise, frees out_buf memory and allocates new chunk of memory.
 // Returns false in case of any error.
 bool merge_sorted_buffers(buffer_t* in_buffers, int in_buf_count, buffer_t* out_buf);
 
+// Receives the next count values of a streamed merge. Returning false stops the merge.
+typedef bool (*merge_consumer_t)(const int* values, size_t count, void* ctx);
+
+// Same as merge_sorted_buffers, but instead of storing the whole output, passes it to consume in windows of at most
+// window_size values, so merges far larger than memory can be checked. Returns false in case of any error or if
+// consume stopped the merge.
+bool merge_sorted_buffers_streamed(buffer_t* in_buffers, int in_buf_count, size_t window_size,
+                                   merge_consumer_t consume, void* ctx);
+
+// Same as merge_sorted_buffers, but stores every distinct value only once.
+// If out_counts isn't NULL, *out_counts is allocated to hold the multiplicity of every stored value.
+// Runs of equal values are skipped with exponential search, so heavily duplicated inputs merge in far less than O(N).
+// Returns false in case of any error. out_buf is freed and emptied then.
+bool merge_sorted_buffers_unique(buffer_t* in_buffers, int in_buf_count, buffer_t* out_buf, size_t** out_counts);
+
 #endif //TASK1_SORT_H
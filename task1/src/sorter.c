@@ -0,0 +1,430 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "sorter.h"
+#include "support.h"
+#include "sort.h"
+#include "scheduler.h"
+#include "coroutine.h"
+#include "packed_run.h"
+
+#include <limits.h>
+#include <memory.h>
+#include <stdio.h>
+
+// Values of a run, which take part in one merge step. Spilled runs are decoded by windows of this size too.
+#define merge_window_size (64 * packed_block_values)
+#define min_budget (64 * 1024)
+#define read_chunk_size (64 * 1024)
+
+typedef struct {
+  // Values of an in-memory run. NULL, if the run was spilled.
+  int* values;
+  // Temporary file of a spilled run in the packed format. -1, if the run is in memory.
+  int fd;
+  packed_reader_t reader;
+  size_t size;
+
+  // Merge state.
+  // Amount of values, which were loaded into windows.
+  size_t loaded;
+  int* window;
+  size_t window_size;
+  size_t window_pos;
+  // Decoded window of a spilled run.
+  int* block;
+} sorter_run_t;
+
+struct sorter_s {
+  // Both in values.
+  size_t budget;
+  size_t memory_used;
+
+  // Unsorted values, which don't form a run yet.
+  buffer_t pending;
+  size_t pending_limit;
+
+  sorter_run_t* runs;
+  int run_count;
+  int run_capacity;
+
+  bool finished;
+
+  // Merged, but not pulled yet values.
+  buffer_t batch;
+  size_t batch_capacity;
+  size_t batch_pos;
+  // Per run views for merge_sorted_buffers.
+  buffer_t* views;
+};
+
+sorter_t* sorter_create(size_t memory_budget) {
+  sorter_t* sorter = calloc(1, sizeof(*sorter));
+  if (!sorter) {
+    perror("Couldn't allocate sorter: ");
+    return NULL;
+  }
+  sorter->budget = memory_budget / sizeof(int);
+  if (sorter->budget < min_budget) {
+    sorter->budget = min_budget;
+  }
+  // A few runs fit into the memory budget at once, so spills are rare for inputs of about the budget size.
+  sorter->pending_limit = sorter->budget / 4;
+  return sorter;
+}
+
+void sorter_destroy(sorter_t* sorter) {
+  if (!sorter) {
+    return;
+  }
+  for (int i = 0; i < sorter->run_count; ++i) {
+    free(sorter->runs[i].values);
+    free(sorter->runs[i].block);
+    if (sorter->runs[i].fd != -1) {
+      packed_reader_close(&sorter->runs[i].reader);
+      close(sorter->runs[i].fd);
+    }
+  }
+  free(sorter->runs);
+  free(sorter->pending.buf);
+  free(sorter->batch.buf);
+  free(sorter->views);
+  free(sorter);
+}
+
+static int create_spill_file() {
+  const char* dir = getenv("TMPDIR");
+  if (!dir || !*dir) {
+    dir = "/tmp";
+  }
+  char path[PATH_MAX];
+  int ret = snprintf(path, sizeof(path), "%s/sort_spill_XXXXXX", dir);
+  if (ret < 0 || (size_t)ret >= sizeof(path)) {
+    fprintf(stderr, "Spill directory path is too long.\n");
+    return -1;
+  }
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    perror("Couldn't create spill file: ");
+    return -1;
+  }
+  // Nobody else needs the file, and it disappears with the last descriptor, even if we crash.
+  unlink(path);
+  return fd;
+}
+
+static bool spill_run(sorter_t* sorter, sorter_run_t* run) {
+  int fd = create_spill_file();
+  if (fd == -1) {
+    return false;
+  }
+  // Sorted runs are spilled delta encoded: several times less bytes to write and to read back.
+  if (!packed_write(fd, run->values, run->size)) {
+    close(fd);
+    return false;
+  }
+  free(run->values);
+  run->values = NULL;
+  run->fd = fd;
+  sorter->memory_used -= run->size;
+  return true;
+}
+
+// Spills the biggest in-memory runs until everything fits into the budget.
+static bool fit_into_budget(sorter_t* sorter) {
+  while (sorter->memory_used > sorter->budget) {
+    sorter_run_t* biggest = NULL;
+    for (int i = 0; i < sorter->run_count; ++i) {
+      sorter_run_t* run = &sorter->runs[i];
+      if (run->values && run->size && (!biggest || run->size > biggest->size)) {
+        biggest = run;
+      }
+    }
+    if (!biggest) {
+      // Only pending values are left in memory.
+      return true;
+    }
+    if (!spill_run(sorter, biggest)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Takes ownership of sorted values.
+static bool add_run(sorter_t* sorter, int* values, size_t size) {
+  if (sorter->run_count == sorter->run_capacity) {
+    int capacity = sorter->run_capacity ? sorter->run_capacity * 2 : 8;
+    sorter_run_t* runs = reallocarray(sorter->runs, capacity, sizeof(sorter_run_t));
+    if (!runs) {
+      perror("Couldn't allocate memory: ");
+      free(values);
+      return false;
+    }
+    sorter->runs = runs;
+    sorter->run_capacity = capacity;
+  }
+  sorter_run_t* run = &sorter->runs[sorter->run_count++];
+  memset(run, 0, sizeof(*run));
+  run->values = values;
+  run->fd = -1;
+  run->size = size;
+  sorter->memory_used += size;
+  return fit_into_budget(sorter);
+}
+
+static bool flush_pending(sorter_t* sorter) {
+  if (!sorter->pending.size) {
+    return true;
+  }
+  sort_buffer(sorter->pending);
+  buffer_t run = sorter->pending;
+  sorter->pending.buf = NULL;
+  sorter->pending.size = 0;
+  // The values are already accounted for.
+  sorter->memory_used -= run.size;
+  return add_run(sorter, run.buf, run.size);
+}
+
+bool sorter_push(sorter_t* sorter, const int* values, size_t count) {
+  if (sorter->finished) {
+    fprintf(stderr, "Values are pushed to a finished sorter.\n");
+    return false;
+  }
+  while (count) {
+    if (!sorter->pending.buf) {
+      sorter->pending.buf = reallocarray(NULL, sorter->pending_limit, sizeof(int));
+      if (!sorter->pending.buf) {
+        perror("Couldn't allocate memory: ");
+        return false;
+      }
+    }
+    size_t take = sorter->pending_limit - sorter->pending.size;
+    if (take > count) {
+      take = count;
+    }
+    memcpy(sorter->pending.buf + sorter->pending.size, values, take * sizeof(int));
+    sorter->pending.size += take;
+    sorter->memory_used += take;
+    values += take;
+    count -= take;
+
+    if (sorter->pending.size == sorter->pending_limit && !flush_pending(sorter)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool sorter_push_fd(sorter_t* sorter, int fd) {
+  char* chunk = malloc(read_chunk_size);
+  if (!chunk) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  buffer_t parsed = {.size = 0, .buf = NULL};
+  int_parser_t parser;
+  int_parser_init(&parser, &parsed);
+
+  bool ok = true;
+  while (ok) {
+    ssize_t bytes_read = read(fd, chunk, read_chunk_size);
+    if (bytes_read < 0) {
+      perror("Couldn't read from file: ");
+      ok = false;
+      break;
+    }
+    if (bytes_read == 0) {
+      ok = int_parser_finish(&parser);
+    } else {
+      ok = int_parser_feed(&parser, chunk, bytes_read);
+    }
+    ok = ok && sorter_push(sorter, parsed.buf, parsed.size);
+    parsed.size = 0;
+    if (bytes_read == 0) {
+      break;
+    }
+  }
+  free(parsed.buf);
+  free(chunk);
+  return ok;
+}
+
+bool sorter_push_files(sorter_t* sorter, const char** files, int file_count) {
+  static const query_t full_sort = {.mode = FullSort, .merge_mode = MergeAll, .io_mode = CachedIO};
+  if (sorter->finished) {
+    fprintf(stderr, "Values are pushed to a finished sorter.\n");
+    return false;
+  }
+  if (file_count <= 0) {
+    return true;
+  }
+
+  buffer_t* buffers = calloc(file_count, sizeof(buffer_t));
+  if (!buffers || !scheduler_initialize(file_count, true)) {
+    perror("Couldn't allocate memory: ");
+    free(buffers);
+    return false;
+  }
+  bool ok = true;
+  for (int i = 0; i < file_count && ok; ++i) {
+    sort_task_t* task = calloc(1, sizeof(*task));
+    if (!task) {
+      perror("Couldn't allocate task: ");
+      ok = false;
+      break;
+    }
+    task->filename = files[i];
+    task->buffer = &buffers[i];
+    task->query = &full_sort;
+    ok = scheduler_add_task(coro_sort_file, task);
+  }
+  ok = ok && scheduler_run_loop();
+  scheduler_destroy();
+
+  for (int i = 0; i < file_count; ++i) {
+    if (ok) {
+      ok = add_run(sorter, buffers[i].buf, buffers[i].size);
+    } else {
+      free(buffers[i].buf);
+    }
+  }
+  free(buffers);
+  return ok;
+}
+
+bool sorter_finish(sorter_t* sorter) {
+  if (sorter->finished) {
+    return true;
+  }
+  if (!flush_pending(sorter)) {
+    return false;
+  }
+  sorter->views = calloc(sorter->run_count ? sorter->run_count : 1, sizeof(buffer_t));
+  if (!sorter->views) {
+    perror("Couldn't allocate memory: ");
+    return false;
+  }
+  sorter->finished = true;
+  return true;
+}
+
+static bool load_window(sorter_run_t* run) {
+  if (run->values) {
+    size_t size = run->size - run->loaded;
+    if (size > merge_window_size) {
+      size = merge_window_size;
+    }
+    run->window = run->values + run->loaded;
+    run->window_size = size;
+  } else {
+    if (!run->block) {
+      run->block = reallocarray(NULL, merge_window_size, sizeof(int));
+      if (!run->block || !packed_reader_open(&run->reader, run->fd, 0)) {
+        perror("Couldn't prepare spill file for reading: ");
+        return false;
+      }
+    }
+    size_t size = 0;
+    while (size + packed_block_values <= merge_window_size) {
+      ssize_t count = packed_reader_next_block(&run->reader, run->block + size);
+      if (count < 0) {
+        return false;
+      }
+      if (count == 0) {
+        break;
+      }
+      size += count;
+    }
+    run->window = run->block;
+    run->window_size = size;
+  }
+  run->window_pos = 0;
+  run->loaded += run->window_size;
+  return true;
+}
+
+// Returns the amount of leading values of the sorted array, which are not greater than bound.
+static size_t upper_bound(const int* values, size_t size, int bound) {
+  size_t lo = 0, hi = size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (values[mid] <= bound) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Merges the next batch of output. Every window is merged up to the least of the window maxima:
+// no value left in any run can be less than that, so the batch is a prefix of the output.
+// The run, which window ends with that least maximum, is always consumed, so each step makes progress.
+static bool merge_next_batch(sorter_t* sorter) {
+  bool has_values = false;
+  int bound = INT_MAX;
+  for (int i = 0; i < sorter->run_count; ++i) {
+    sorter_run_t* run = &sorter->runs[i];
+    if (run->window_pos == run->window_size && run->loaded < run->size && !load_window(run)) {
+      return false;
+    }
+    if (run->window_pos < run->window_size) {
+      int last = run->window[run->window_size - 1];
+      if (!has_values || last < bound) {
+        bound = last;
+      }
+      has_values = true;
+    }
+  }
+
+  size_t all_size = 0;
+  for (int i = 0; i < sorter->run_count; ++i) {
+    sorter_run_t* run = &sorter->runs[i];
+    size_t take = 0;
+    if (has_values) {
+      take = upper_bound(run->window + run->window_pos, run->window_size - run->window_pos, bound);
+    }
+    sorter->views[i].buf = run->window + run->window_pos;
+    sorter->views[i].size = take;
+    run->window_pos += take;
+    all_size += take;
+  }
+
+  // merge_sorted_buffers treats the size of the output buffer as its capacity.
+  sorter->batch.size = sorter->batch_capacity;
+  if (!merge_sorted_buffers(sorter->views, sorter->run_count, &sorter->batch)) {
+    return false;
+  }
+  sorter->batch_capacity = sorter->batch.size;
+  sorter->batch.size = all_size;
+  sorter->batch_pos = 0;
+  return true;
+}
+
+ssize_t sorter_pull(sorter_t* sorter, int* out, size_t max_count) {
+  if (!sorter->finished) {
+    fprintf(stderr, "Output is pulled from an unfinished sorter.\n");
+    return -1;
+  }
+  size_t count = 0;
+  while (count < max_count) {
+    if (sorter->batch_pos == sorter->batch.size) {
+      if (!merge_next_batch(sorter)) {
+        return -1;
+      }
+      if (!sorter->batch.size) {
+        break;
+      }
+    }
+    size_t take = sorter->batch.size - sorter->batch_pos;
+    if (take > max_count - count) {
+      take = max_count - count;
+    }
+    memcpy(out + count, sorter->batch.buf + sorter->batch_pos, take * sizeof(int));
+    sorter->batch_pos += take;
+    count += take;
+  }
+  return (ssize_t)count;
+}
@@ -0,0 +1,53 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_SORTER_H
+#define TASK1_SORTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Embeddable streaming sort.
+//
+// Values are pushed in any order: as arrays, as text from file descriptors or as whole files, which are sorted in
+// coroutines by the scheduler. Pushed values are gathered into sorted runs. Once the runs don't fit into the
+// memory budget, the biggest ones are spilled to unlinked temporary files.
+// After sorter_finish() the runs are k-way merged lazily, while the output is pulled in batches.
+//
+// Usage:
+//   sorter_t* sorter = sorter_create(64 << 20);
+//   sorter_push(sorter, values, count);
+//   sorter_push_fd(sorter, fd);
+//   sorter_finish(sorter);
+//   while ((count = sorter_pull(sorter, batch, batch_size)) > 0) { ... }
+//   sorter_destroy(sorter);
+typedef struct sorter_s sorter_t;
+
+// Creates a sorter, which keeps about memory_budget bytes of values in memory.
+// Spills go to $TMPDIR, or to /tmp if it's not set.
+// Returns NULL in case of any error.
+sorter_t* sorter_create(size_t memory_budget);
+void sorter_destroy(sorter_t* sorter);
+
+// Push API. Can be called only before sorter_finish().
+// All of these return false in case of any error.
+// ------------------------------------
+bool sorter_push(sorter_t* sorter, const int* values, size_t count);
+// Parses whitespace separated integers from fd until EOF. The fd is left open.
+bool sorter_push_fd(sorter_t* sorter, int fd);
+// Reads and sorts the files concurrently inside coroutines. Every file becomes a separate run.
+// Uses the scheduler, so it can't be called from inside a coroutine.
+bool sorter_push_files(sorter_t* sorter, const char** files, int file_count);
+// ------------------------------------
+
+// Ends the push phase.
+// Returns false in case of any error.
+bool sorter_finish(sorter_t* sorter);
+
+// Stores the next at most max_count values of the merged output into out.
+// Returns the amount of stored values, 0 if the whole output was pulled, or -1 in case of any error.
+ssize_t sorter_pull(sorter_t* sorter, int* out, size_t max_count);
+
+#endif //TASK1_SORTER_H
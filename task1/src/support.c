@@ -4,45 +4,173 @@
 
 #include "support.h"
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <memory.h>
+#include <stdio.h>
 #include <sys/stat.h>
 
 bool check_if_exists(const char *file) {
   return !access(file, R_OK);
 }
 
-bool store_buffer_to_file(const buffer_t buffer, const char *filename) {
-  FILE* f = fopen(filename, "w");
-  if (f == NULL) {
+bool file_writer_open(file_writer_t* writer, const char* filename, enum IO_MODE mode) {
+  memset(writer, 0, sizeof(*writer));
+  writer->mode = mode;
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  writer->fd = open(filename, flags | (mode == DirectIO ? O_DIRECT : 0), 0644);
+  if (writer->fd == -1 && mode == DirectIO && errno == EINVAL) {
+    fprintf(stderr, "%s: direct I/O isn't supported by the file system, writing through the page cache.\n", filename);
+    writer->mode = NoCacheIO;
+    writer->fd = open(filename, flags, 0644);
+  }
+  if (writer->fd == -1) {
     perror("Couldn't create file: ");
     return false;
   }
+  if (posix_memalign((void**)&writer->buf, io_alignment, io_chunk_size) != 0) {
+    perror("Couldn't allocate memory: ");
+    close(writer->fd);
+    writer->buf = NULL;
+    return false;
+  }
+  return true;
+}
 
-  for (int i = 0; i < buffer.size; ++i) {
-    fprintf(f, "%d%s", buffer.buf[i], (i == buffer.size ? "" : " "));
-    if (ferror(f)) {
-      fprintf(stderr, "Couldn't write to a file.");
-      fclose(f);
+static bool file_writer_flush(file_writer_t* writer) {
+  if (!writer->size) {
+    return true;
+  }
+  if (!write_full(writer->fd, writer->buf, writer->size)) {
+    perror("Couldn't write to a file: ");
+    return false;
+  }
+  if (writer->mode == NoCacheIO) {
+    // Dirty pages can't be dropped, so write them out first.
+    sync_file_range(writer->fd, writer->offset, writer->size,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(writer->fd, writer->offset, writer->size, POSIX_FADV_DONTNEED);
+  }
+  writer->offset += writer->size;
+  writer->size = 0;
+  return true;
+}
+
+bool file_writer_write(file_writer_t* writer, const char* bytes, size_t size) {
+  while (size) {
+    size_t take = io_chunk_size - writer->size;
+    if (take > size) {
+      take = size;
+    }
+    memcpy(writer->buf + writer->size, bytes, take);
+    writer->size += take;
+    bytes += take;
+    size -= take;
+    if (writer->size == io_chunk_size && !file_writer_flush(writer)) {
       return false;
     }
   }
-  fclose(f);
   return true;
 }
 
-static bool expand(buffer_t* buffer, int* capacity) {
+bool file_writer_close(file_writer_t* writer) {
+  bool ok = true;
+  if (writer->size && writer->mode == DirectIO) {
+    // The tail isn't aligned, so it can't be written directly.
+    int flags = fcntl(writer->fd, F_GETFL);
+    ok = flags != -1 && fcntl(writer->fd, F_SETFL, flags & ~O_DIRECT) != -1;
+    if (!ok) {
+      perror("Couldn't write to a file: ");
+    }
+  }
+  ok = ok && file_writer_flush(writer);
+  ok = (close(writer->fd) == 0) && ok;
+  free(writer->buf);
+  writer->buf = NULL;
+  return ok;
+}
+
+// Writes the decimal representation of val to out. Returns the amount of written chars.
+static size_t format_int(int val, char* out) {
+  char digits[16];
+  size_t count = 0;
+  unsigned int abs_val = val < 0 ? 0u - (unsigned int)val : (unsigned int)val;
+  do {
+    digits[count++] = (char)('0' + abs_val % 10);
+    abs_val /= 10;
+  } while (abs_val);
+
+  size_t size = 0;
+  if (val < 0) {
+    out[size++] = '-';
+  }
+  while (count) {
+    out[size++] = digits[--count];
+  }
+  return size;
+}
+
+bool store_buffer_to_file(const buffer_t buffer, const char *filename, enum IO_MODE io_mode) {
+  file_writer_t writer;
+  if (!file_writer_open(&writer, filename, io_mode)) {
+    return false;
+  }
+
+  bool ok = true;
+  char line[16];
+  for (size_t i = 0; i < buffer.size && ok; ++i) {
+    size_t size = format_int(buffer.buf[i], line);
+    line[size++] = ' ';
+    ok = file_writer_write(&writer, line, size);
+  }
+  ok = file_writer_close(&writer) && ok;
+  if (!ok) {
+    fprintf(stderr, "Couldn't write to a file.");
+  }
+  return ok;
+}
+
+bool store_counts_to_file(const buffer_t buffer, const size_t *counts, const char *filename, enum IO_MODE io_mode) {
+  file_writer_t writer;
+  if (!file_writer_open(&writer, filename, io_mode)) {
+    return false;
+  }
+
+  bool ok = true;
+  char line[48];
+  for (size_t i = 0; i < buffer.size && ok; ++i) {
+    size_t size = format_int(buffer.buf[i], line);
+    size += snprintf(line + size, sizeof(line) - size, " %zu\n", counts[i]);
+    ok = file_writer_write(&writer, line, size);
+  }
+  ok = file_writer_close(&writer) && ok;
+  if (!ok) {
+    fprintf(stderr, "Couldn't write to a file.");
+  }
+  return ok;
+}
+
+static bool expand(buffer_t* buffer, size_t* capacity) {
   *capacity *= 2;
-  buffer->buf = reallocarray(buffer->buf, *capacity, sizeof(int));
-  if (!buffer->buf) {
+  int* buf = reallocarray(buffer->buf, *capacity, sizeof(int));
+  if (!buf) {
     perror("Couldn't allocate memory: ");
     return false;
   }
+  buffer->buf = buf;
   return true;
 }
 
 bool bytes_to_buffer(char* bytes, buffer_t* buffer) {
+  char* end;
+  return bytes_to_buffer_until(bytes, buffer, &end);
+}
+
+bool bytes_to_buffer_until(char* bytes, buffer_t* buffer, char** end) {
   char* ptr = bytes;
-  int capacity = 64;
+  *end = ptr;
+  size_t capacity = 64;
   if (!expand(buffer, &capacity)) {
     return false;
   }
@@ -54,6 +182,7 @@ bool bytes_to_buffer(char* bytes, buffer_t* buffer) {
       break;
     }
     ptr = ptr2;
+    *end = ptr;
     buffer->buf[buffer->size++] = val;
     if (buffer->size == capacity && !expand(buffer, &capacity)) {
       return false;
@@ -63,14 +192,160 @@ bool bytes_to_buffer(char* bytes, buffer_t* buffer) {
 }
 
 
+void int_parser_init(int_parser_t* parser, buffer_t* buffer) {
+  memset(parser, 0, sizeof(*parser));
+  parser->buffer = buffer;
+  parser->capacity = buffer->size;
+}
+
+static bool int_parser_push(int_parser_t* parser, int val) {
+  buffer_t* buffer = parser->buffer;
+  if (buffer->size == parser->capacity) {
+    size_t capacity = parser->capacity ? parser->capacity * 2 : 128;
+    int* buf = reallocarray(buffer->buf, capacity, sizeof(int));
+    if (!buf) {
+      perror("Couldn't allocate memory: ");
+      return false;
+    }
+    buffer->buf = buf;
+    parser->capacity = capacity;
+  }
+  buffer->buf[buffer->size++] = val;
+  return true;
+}
+
+static bool int_parser_token(int_parser_t* parser, const char* token, size_t size) {
+  size_t i = 0;
+  bool negative = false;
+  if (token[0] == '-' || token[0] == '+') {
+    negative = token[0] == '-';
+    ++i;
+  }
+  if (i == size) {
+    parser->stopped = true;
+    return true;
+  }
+  // Out of range values saturate to LONG_MIN and LONG_MAX the same way as strtol does, so the result is the same as
+  // the one of the strtol-based parsing.
+  unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+  unsigned long val = 0;
+  for (; i < size; ++i) {
+    if (!isdigit((unsigned char)token[i])) {
+      parser->stopped = true;
+      return true;
+    }
+    unsigned long digit = token[i] - '0';
+    val = val > (limit - digit) / 10 ? limit : val * 10 + digit;
+  }
+  long result = negative ? (val == limit ? LONG_MIN : -(long)val) : (long)val;
+  return int_parser_push(parser, (int)result);
+}
+
+bool int_parser_feed(int_parser_t* parser, const char* bytes, size_t size) {
+  const char* ptr = bytes;
+  const char* end = bytes + size;
+  if (parser->stopped) {
+    return true;
+  }
+
+  if (parser->carry_size) {
+    while (ptr < end && !isspace((unsigned char)*ptr)) {
+      if (parser->carry_size == sizeof(parser->carry)) {
+        // Way too long to be a number.
+        parser->stopped = true;
+        return true;
+      }
+      parser->carry[parser->carry_size++] = *ptr++;
+    }
+    if (ptr == end) {
+      return true;
+    }
+    bool ok = int_parser_token(parser, parser->carry, parser->carry_size);
+    parser->carry_size = 0;
+    if (!ok || parser->stopped) {
+      return ok;
+    }
+  }
+
+  while (true) {
+    while (ptr < end && isspace((unsigned char)*ptr)) {
+      ++ptr;
+    }
+    if (ptr == end) {
+      return true;
+    }
+    const char* token = ptr;
+    while (ptr < end && !isspace((unsigned char)*ptr)) {
+      ++ptr;
+    }
+    if (ptr == end) {
+      // The number may continue in the next chunk.
+      if ((size_t)(ptr - token) > sizeof(parser->carry)) {
+        parser->stopped = true;
+        return true;
+      }
+      memcpy(parser->carry, token, ptr - token);
+      parser->carry_size = ptr - token;
+      return true;
+    }
+    if (!int_parser_token(parser, token, ptr - token)) {
+      return false;
+    }
+    if (parser->stopped) {
+      return true;
+    }
+  }
+}
+
+bool int_parser_finish(int_parser_t* parser) {
+  if (parser->stopped || !parser->carry_size) {
+    return true;
+  }
+  bool ok = int_parser_token(parser, parser->carry, parser->carry_size);
+  parser->carry_size = 0;
+  return ok;
+}
+
+bool read_full(int fd, void* data, size_t size) {
+  char* ptr = data;
+  while (size) {
+    ssize_t ret = read(fd, ptr, size);
+    if (ret == -1 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    ptr += ret;
+    size -= ret;
+  }
+  return true;
+}
+
+bool write_full(int fd, const void* data, size_t size) {
+  const char* ptr = data;
+  while (size) {
+    ssize_t ret = write(fd, ptr, size);
+    if (ret == -1 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    ptr += ret;
+    size -= ret;
+  }
+  return true;
+}
+
 bool read_buffer_sync(const char *file, buffer_t *buffer) {
   int fd = open(file, O_RDONLY);
   if (fd == -1) {
     perror("Couldn't open a file: ");
     return false;
   }
-  int capacity = 128;
-  int size = 0;
+  size_t capacity = 128;
+  size_t size = 0;
   char* bytes = malloc(capacity);
   if (!bytes) {
     close(fd);
@@ -79,26 +354,28 @@ bool read_buffer_sync(const char *file, buffer_t *buffer) {
   }
   memset(bytes, 0, capacity);
   while (true) {
-    int bytes_read = read(fd, bytes + size, capacity - size);
+    ssize_t bytes_read = read(fd, bytes + size, capacity - size);
     if (bytes_read < 0) {
       perror("Couldn't read from file: ");
       free(bytes);
       close(fd);
       return false;
-    } else if (bytes_read < capacity - size) {
+    } else if ((size_t)bytes_read < capacity - size) {
       size += bytes_read;
       break;
     }
     size += bytes_read;
     if (capacity == size) {
       capacity *= 2;
-      bytes = realloc(bytes, capacity);
-      memset(bytes + size, 0, size);
-      if (!bytes) {
+      char* expanded = realloc(bytes, capacity);
+      if (!expanded) {
+        free(bytes);
         close(fd);
         perror("Couldn't allocate memory: ");
         return false;
       }
+      bytes = expanded;
+      memset(bytes + size, 0, size);
     }
   }
   close(fd);
@@ -17,18 +17,80 @@ typedef struct {
   int* buf;
 } buffer_t;
 
+enum IO_MODE {
+  // Plain reads and writes through the page cache.
+  CachedIO,
+  // Through the page cache, but the pages are dropped once they are consumed or written,
+  // so other workloads on the host keep their hot data cached.
+  NoCacheIO,
+  // O_DIRECT through aligned buffers.
+  DirectIO,
+};
+
+// Files are read and written by chunks of this size, aligned for O_DIRECT.
+#define io_chunk_size (1024 * 1024)
+#define io_alignment 4096
+
 // Checks if file exists and open for reading.
 bool check_if_exists(const char* file);
 // Returns file size, or -1, in case of any error.
 ssize_t get_file_size(const char* file);
 
+// Buffered writer of output files, which follows the IO_MODE.
+typedef struct {
+  int fd;
+  enum IO_MODE mode;
+
+  char* buf;
+  size_t size;
+  off_t offset;
+} file_writer_t;
+
+// Creates the file, truncating it beforehand.
+// Returns false in case of any error.
+bool file_writer_open(file_writer_t* writer, const char* filename, enum IO_MODE mode);
+bool file_writer_write(file_writer_t* writer, const char* bytes, size_t size);
+// Flushes the rest of the data and closes the file. Has to be called even after an error.
+bool file_writer_close(file_writer_t* writer);
+
 // Stores the int buffer to the file, truncating the file beforehand.
 // The buffer remains untouched.
 // Returns false in case of any error.
-bool store_buffer_to_file(buffer_t buffer, const char* filename);
+bool store_buffer_to_file(buffer_t buffer, const char* filename, enum IO_MODE io_mode);
+
+// Stores "value count" lines, one per value of the buffer, truncating the file beforehand.
+// Returns false in case of any error.
+bool store_counts_to_file(buffer_t buffer, const size_t* counts, const char* filename, enum IO_MODE io_mode);
 
 // Reads integers from bytes array and stores them into buffer. Allocates more space, if necessary.
 bool bytes_to_buffer(char* bytes, buffer_t* buffer);
+// Same, but *end receives the position, where parsing stopped: the end of bytes, or the whitespace before the first
+// token, which isn't a number.
+bool bytes_to_buffer_until(char* bytes, buffer_t* buffer, char** end);
+
+// Incremental parser of whitespace separated integers. The text may be fed in chunks of any size:
+// a number cut by the end of a chunk is carried over to the next one.
+typedef struct {
+  // Parsed values are appended here.
+  buffer_t* buffer;
+  size_t capacity;
+
+  char carry[32];
+  size_t carry_size;
+  // Set after the first token, which isn't a number. Like bytes_to_buffer, parsing stops there.
+  bool stopped;
+} int_parser_t;
+
+void int_parser_init(int_parser_t* parser, buffer_t* buffer);
+// Returns false in case of any error.
+bool int_parser_feed(int_parser_t* parser, const char* bytes, size_t size);
+// Parses the number carried over from the last chunk, if any.
+bool int_parser_finish(int_parser_t* parser);
+
+// read(2) and write(2) wrappers, which transfer exactly size bytes.
+// Return false in case of any error or unexpected EOF.
+bool read_full(int fd, void* data, size_t size);
+bool write_full(int fd, const void* data, size_t size);
 
 // Blocking read from file.
 // Parses the file until EOF.
@@ -0,0 +1,239 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "workers.h"
+
+#include <memory.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Layout of a worker's memfd: the amount of runs, then (file index, run size) pairs, then the runs one by one.
+typedef struct {
+  uint64_t file_index;
+  uint64_t size;
+} run_header_t;
+
+typedef struct {
+  pid_t pid;
+  int memfd;
+
+  int* files;
+  int file_count;
+  uint64_t load;
+
+  void* mapping;
+  size_t mapping_size;
+} worker_t;
+
+static worker_t* workers = NULL;
+static int workers_count = 0;
+
+// Longest files go first, each to the least loaded worker.
+static bool assign_files(const char** files, int file_count) {
+  int* order = reallocarray(NULL, file_count, sizeof(int));
+  uint64_t* sizes = reallocarray(NULL, file_count, sizeof(uint64_t));
+  if (!order || !sizes) {
+    perror("Couldn't allocate memory: ");
+    free(order);
+    free(sizes);
+    return false;
+  }
+  for (int i = 0; i < file_count; ++i) {
+    ssize_t size = get_file_size(files[i]);
+    sizes[i] = size > 0 ? size : 0;
+    order[i] = i;
+  }
+  // Insertion sort by decreasing size: there are not that many files.
+  for (int i = 1; i < file_count; ++i) {
+    int idx = order[i];
+    int j = i;
+    while (j > 0 && sizes[order[j - 1]] < sizes[idx]) {
+      order[j] = order[j - 1];
+      --j;
+    }
+    order[j] = idx;
+  }
+  for (int i = 0; i < file_count; ++i) {
+    worker_t* least = &workers[0];
+    for (int w = 1; w < workers_count; ++w) {
+      if (workers[w].load < least->load) {
+        least = &workers[w];
+      }
+    }
+    least->files[least->file_count++] = order[i];
+    least->load += sizes[order[i]];
+  }
+  free(order);
+  free(sizes);
+  return true;
+}
+
+static bool store_runs(int memfd, const worker_t* worker, const buffer_t* buffers) {
+  uint64_t run_count = worker->file_count;
+  bool ok = write_full(memfd, &run_count, sizeof(run_count));
+  for (int i = 0; i < worker->file_count && ok; ++i) {
+    run_header_t header = {.file_index = worker->files[i], .size = buffers[i].size};
+    ok = write_full(memfd, &header, sizeof(header));
+  }
+  for (int i = 0; i < worker->file_count && ok; ++i) {
+    ok = write_full(memfd, buffers[i].buf, buffers[i].size * sizeof(int));
+  }
+  if (!ok) {
+    perror("Couldn't store sorted runs: ");
+  }
+  return ok;
+}
+
+// Body of a worker process. Never returns.
+static void run_worker(const worker_t* worker, const char** files, const sort_task_t* settings) {
+  buffer_t* buffers = calloc(worker->file_count ? worker->file_count : 1, sizeof(buffer_t));
+  bool ok = buffers && scheduler_initialize(worker->file_count, false);
+  for (int i = 0; i < worker->file_count && ok; ++i) {
+    sort_task_t* task = malloc(sizeof(*task));
+    if (!task) {
+      ok = false;
+      break;
+    }
+    *task = *settings;
+    task->filename = files[worker->files[i]];
+    task->buffer = &buffers[i];
+    ok = scheduler_add_task(coro_sort_file, task);
+  }
+  ok = ok && scheduler_run_loop();
+  ok = ok && store_runs(worker->memfd, worker, buffers);
+  fflush(stdout);
+  _exit(ok ? 0 : 1);
+}
+
+// Maps the memfd of a finished worker and points the buffers of its files into the mapping.
+static bool collect_runs(worker_t* worker, buffer_t* in_buffers, int file_count) {
+  struct stat st;
+  if (fstat(worker->memfd, &st) == -1 || st.st_size < (off_t)sizeof(uint64_t)) {
+    fprintf(stderr, "Worker %d left no results.\n", (int)worker->pid);
+    return false;
+  }
+  worker->mapping_size = st.st_size;
+  worker->mapping = mmap(NULL, worker->mapping_size, PROT_READ, MAP_SHARED, worker->memfd, 0);
+  if (worker->mapping == MAP_FAILED) {
+    worker->mapping = NULL;
+    perror("Couldn't map worker results: ");
+    return false;
+  }
+
+  const char* base = worker->mapping;
+  uint64_t run_count;
+  memcpy(&run_count, base, sizeof(run_count));
+  size_t offset = sizeof(run_count) + run_count * sizeof(run_header_t);
+  if (run_count != (uint64_t)worker->file_count || offset > worker->mapping_size) {
+    fprintf(stderr, "Worker %d left damaged results.\n", (int)worker->pid);
+    return false;
+  }
+  const run_header_t* headers = (const run_header_t*)(base + sizeof(run_count));
+  for (uint64_t i = 0; i < run_count; ++i) {
+    if (headers[i].file_index >= (uint64_t)file_count
+        || headers[i].size > (worker->mapping_size - offset) / sizeof(int)) {
+      fprintf(stderr, "Worker %d left damaged results.\n", (int)worker->pid);
+      return false;
+    }
+    in_buffers[headers[i].file_index].buf = (int*)(base + offset);
+    in_buffers[headers[i].file_index].size = headers[i].size;
+    offset += headers[i].size * sizeof(int);
+  }
+  return true;
+}
+
+static void report_failure(const worker_t* worker, const char** files, int status) {
+  if (WIFSIGNALED(status)) {
+    fprintf(stderr, "Worker %d was killed by signal %d. Its files:", (int)worker->pid, WTERMSIG(status));
+  } else {
+    fprintf(stderr, "Worker %d failed. Its files:", (int)worker->pid);
+  }
+  for (int i = 0; i < worker->file_count; ++i) {
+    fprintf(stderr, " %s", files[worker->files[i]]);
+  }
+  fprintf(stderr, "\n");
+}
+
+bool workers_sort_files(const char** files, int file_count, int worker_count, const sort_task_t* settings,
+                        buffer_t* in_buffers) {
+  if (worker_count > file_count) {
+    worker_count = file_count;
+  }
+  workers = calloc(worker_count, sizeof(worker_t));
+  if (!workers) {
+    perror("Couldn't allocate workers: ");
+    return false;
+  }
+  workers_count = worker_count;
+  for (int w = 0; w < worker_count; ++w) {
+    workers[w].memfd = -1;
+    workers[w].files = calloc(file_count, sizeof(int));
+    if (!workers[w].files) {
+      perror("Couldn't allocate workers: ");
+      return false;
+    }
+  }
+  if (!assign_files(files, file_count)) {
+    return false;
+  }
+
+  // Whatever is buffered would be written by every worker otherwise.
+  fflush(stdout);
+  fflush(stderr);
+  bool ok = true;
+  for (int w = 0; w < worker_count && ok; ++w) {
+    workers[w].memfd = memfd_create("sort_worker_runs", MFD_CLOEXEC);
+    if (workers[w].memfd == -1) {
+      perror("Couldn't create memfd: ");
+      ok = false;
+      break;
+    }
+    workers[w].pid = fork();
+    if (workers[w].pid == 0) {
+      run_worker(&workers[w], files, settings);
+    } else if (workers[w].pid == -1) {
+      perror("Couldn't fork a worker: ");
+      ok = false;
+    }
+  }
+
+  // Every started worker is waited for, even if some of them failed.
+  for (int w = 0; w < worker_count; ++w) {
+    if (workers[w].pid <= 0) {
+      continue;
+    }
+    int status;
+    if (waitpid(workers[w].pid, &status, 0) == -1) {
+      perror("waitpid: ");
+      ok = false;
+      continue;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      report_failure(&workers[w], files, status);
+      ok = false;
+      continue;
+    }
+    ok = collect_runs(&workers[w], in_buffers, file_count) && ok;
+  }
+  return ok;
+}
+
+void workers_release() {
+  for (int w = 0; w < workers_count; ++w) {
+    if (workers[w].mapping) {
+      munmap(workers[w].mapping, workers[w].mapping_size);
+    }
+    if (workers[w].memfd != -1) {
+      close(workers[w].memfd);
+    }
+    free(workers[w].files);
+  }
+  free(workers);
+  workers = NULL;
+  workers_count = 0;
+}
@@ -0,0 +1,26 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef TASK1_WORKERS_H
+#define TASK1_WORKERS_H
+
+#include "support.h"
+#include "coroutine.h"
+
+// Multi-process mode.
+// The files are spread between worker_count forked processes, balanced by their sizes. Every worker runs its own
+// scheduler over its files, the same way the single-process mode does, and leaves the reduced runs in a memfd.
+// The parent maps the memfds and hands the runs out right from the mappings, without copying.
+// A crashed worker can't take the parent down: its files are reported, and the call fails.
+//
+// settings provides the cache directory and the query for every file. in_buffers[i] receives the run of files[i];
+// the buffers stay valid until workers_release().
+// Returns false in case of any error.
+bool workers_sort_files(const char** files, int file_count, int worker_count, const sort_task_t* settings,
+                        buffer_t* in_buffers);
+
+// Unmaps the runs of the workers.
+void workers_release();
+
+#endif //TASK1_WORKERS_H
@@ -0,0 +1,183 @@
+#include "src/support.h"
+#include "src/packed_run.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <memory.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+// Streaming verifier of the sort output. Unlike checker.py it never holds more than a chunk of the file in memory.
+
+typedef struct {
+  bool check_order;
+  bool has_values;
+  int prev;
+  bool failed;
+
+  uint64_t count;
+  uint64_t distinct;
+  int min;
+  int max;
+  // Order independent hash of the multiset of values, so the output can be matched against the inputs.
+  uint64_t checksum;
+} stats_t;
+
+static uint64_t mix(int val) {
+  uint64_t x = (uint32_t)val;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+static void consume_values(stats_t* stats, const int* values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    int val = values[i];
+    if (!stats->has_values) {
+      stats->min = stats->max = val;
+      stats->distinct = 1;
+      stats->has_values = true;
+    } else {
+      if (stats->check_order && val < stats->prev && !stats->failed) {
+        printf("Error on numbers %d %d (index %" PRIu64 ")\n", stats->prev, val, stats->count);
+        stats->failed = true;
+      }
+      if (val != stats->prev) {
+        stats->distinct++;
+      }
+      if (val < stats->min) {
+        stats->min = val;
+      }
+      if (val > stats->max) {
+        stats->max = val;
+      }
+    }
+    stats->prev = val;
+    stats->count++;
+    stats->checksum += mix(val);
+  }
+}
+
+static bool stream_packed(int fd, stats_t* stats) {
+  packed_reader_t reader;
+  if (!packed_reader_open(&reader, fd, 0)) {
+    return false;
+  }
+  int block[packed_block_values];
+  ssize_t count;
+  while ((count = packed_reader_next_block(&reader, block)) > 0) {
+    consume_values(stats, block, count);
+  }
+  packed_reader_close(&reader);
+  return count == 0;
+}
+
+// Feeds all the values of the file, either text or packed, to stats.
+static bool stream_file(const char* file, stats_t* stats) {
+  int fd = open(file, O_RDONLY);
+  if (fd == -1) {
+    perror(file);
+    return false;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  char* chunk = malloc(io_chunk_size);
+  buffer_t parsed = {.size = 0, .buf = NULL};
+  int_parser_t parser;
+  int_parser_init(&parser, &parsed);
+
+  bool ok = chunk != NULL;
+  bool first_chunk = true;
+  while (ok) {
+    ssize_t bytes_read = read(fd, chunk, io_chunk_size);
+    if (bytes_read < 0) {
+      perror(file);
+      ok = false;
+      break;
+    }
+    if (first_chunk && packed_is_packed(chunk, bytes_read)) {
+      ok = stream_packed(fd, stats);
+      break;
+    }
+    first_chunk = false;
+    ok = bytes_read ? int_parser_feed(&parser, chunk, bytes_read) : int_parser_finish(&parser);
+    consume_values(stats, parsed.buf, parsed.size);
+    parsed.size = 0;
+    if (!bytes_read) {
+      break;
+    }
+  }
+  free(parsed.buf);
+  free(chunk);
+  close(fd);
+  return ok;
+}
+
+static void print_usage() {
+  fprintf(stderr, "Usage: ./verify [options] result_file [in_file1 ...]\n"
+                  "  -n count  expected amount of values\n"
+                  "  in_files  inputs of the sort: the output has to hold exactly the same multiset of values\n");
+}
+
+int main(int argc, char** argv) {
+  bool has_expected_count = false;
+  uint64_t expected_count = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "hn:")) != -1) {
+    switch (opt) {
+      case 'n':
+        has_expected_count = true;
+        expected_count = strtoull(optarg, NULL, 10);
+        break;
+      default:
+        print_usage();
+        return -1;
+    }
+  }
+  if (optind >= argc) {
+    print_usage();
+    return -1;
+  }
+
+  stats_t output;
+  memset(&output, 0, sizeof(output));
+  output.check_order = true;
+  if (!stream_file(argv[optind], &output)) {
+    return -1;
+  }
+
+  printf("count: %" PRIu64 "\n", output.count);
+  if (output.count) {
+    printf("min: %d\nmax: %d\ndistinct: %" PRIu64 "\n", output.min, output.max, output.distinct);
+  }
+  printf("checksum: %016" PRIx64 "\n", output.checksum);
+
+  bool ok = !output.failed;
+  if (has_expected_count && output.count != expected_count) {
+    printf("Error: expected %" PRIu64 " values\n", expected_count);
+    ok = false;
+  }
+  if (optind + 1 < argc) {
+    stats_t inputs;
+    memset(&inputs, 0, sizeof(inputs));
+    for (int i = optind + 1; i < argc; ++i) {
+      if (!stream_file(argv[i], &inputs)) {
+        return -1;
+      }
+    }
+    if (inputs.count != output.count || inputs.checksum != output.checksum) {
+      printf("Error: the inputs hold %" PRIu64 " values with checksum %016" PRIx64 "\n", inputs.count,
+             inputs.checksum);
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    return 1;
+  }
+  printf("All is ok\n");
+  return 0;
+}
@@ -61,6 +61,132 @@ tests = [
 "false || echo 123"
 ],
 [
+"hash -r",
+"hash nosuch_command_x",
+"hash sh && hash | tail -n +2 | wc -l",
+"hash -r && hash | tail -n +2 | wc -l"
+],
+[
+"echo -n abc && echo def",
+"pwd | tail -c 8",
+"test 1 -lt 2 && echo lt",
+"[ abc = abd ] || echo ne",
+"test -d . && [ -f nofile ] || echo nofile",
+"printf '%s-%d\\\\n' x 42",
+"printf 'a\\\\tb\\\\n' > out.txt && cat out.txt",
+"cd .. && cd testdir && pwd | tail -c 8",
+"false || true && echo ok"
+],
+[
+"sleep 0.2 &",
+"jobs",
+"wait %1 && echo waited",
+"jobs",
+"sleep 0.1 && exit 3 &",
+"wait -n || echo failed",
+"sh -c 'kill -STOP $$'",
+"jobs",
+"fg",
+"fg %abc",
+"bg",
+"wait 12x"
+],
+[
+"printf '1\\\\n2\\\\n3\\\\n' | parallel -j 2 echo n",
+"printf '0\\\\n3\\\\n0\\\\n' > codes.txt",
+"parallel sh -c 'exit $0' < codes.txt || echo failed",
+"parallel -j 0 echo"
+],
+[
+"set -o",
+"set -o pipesize 262144",
+"set -o",
+"head -c 300000 /dev/zero | cat | wc -c",
+"set +o pipesize",
+"set -o",
+"set -o pipesize abc"
+],
+[
+"echo 'x y' > in.txt",
+"wc -w < in.txt",
+"tr a-z A-Z <<< 'here string'",
+"cat <<EOF\nline one\n  line two\nEOF",
+"cat < nofile.txt",
+"echo ignored | cat < in.txt"
+],
+[
+"sh -c '\"$(readlink /proc/$PPID/exe)\" -c \"time true | true\" 2>&1 | sed \"s/[0-9.]//g\"'",
+"sh -c 'CSHELL_TRACE=1 \"$(readlink /proc/$PPID/exe)\" -c \"echo x\" 2>&1 | cut -d\" \" -f1-3'"
+],
+[
+"echo repeat",
+"echo repeat",
+"cat <<EOF\nfirst\nEOF",
+"cat <<EOF\nsecond\nEOF",
+"false && echo and",
+"true && echo and",
+"false && echo and"
+],
+[
+"head -c 1000000 /dev/zero | cat | cat | wc -c",
+"yes | head -n 100000 | wc -l",
+"seq 1 200000 | sort -rn | head -n 2"
+],
+[
+"/bin/echo spawned by path",
+"nosuch_command_xyz || echo failed",
+"echo 'echo script without interpreter line: $1' > noformat.sh",
+"chmod +x noformat.sh",
+"./noformat.sh arg",
+"sh -c 'exit 5' || echo failed"
+],
+[
+"head -c 65521 /dev/zero | tr '\\\\0' x | sed 's/^/true /' > quote.sh",
+"echo >> quote.sh",
+"cp quote.sh cont.sh",
+"echo \"echo 'quoted text'\" >> quote.sh",
+"echo 'echo con\\\\' >> cont.sh",
+"echo 'tinued' >> cont.sh",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" < quote.sh'",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" < cont.sh'",
+"printf 'echo first\\\\necho no trailing newline' > last.sh",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" last.sh'"
+],
+[
+"echo 'echo in script' > script.sh",
+"echo 'exit 3' >> script.sh",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" script.sh; echo status $?'",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" -c \"echo in -c | tr a-z A-Z\"; echo status $?'",
+"echo \"echo 'unterminated\" > broken.sh",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" broken.sh 2>&1; echo status $?'",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" nofile.sh 2>&1; echo status $?'"
+],
+[
+"seq -s ' ' 1 20000 | sed 's/^/echo /' > words.sh",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" words.sh | wc -w'",
+"sh -c '\"$(readlink /proc/$PPID/exe)\" < words.sh | wc -w'",
+"echo a b c d e f g h i j k l m n o p q r s t u v w x y z | wc -w",
+"echo short"
+],
+[
+"echo \"a b\"'c d'e",
+"echo a\"\"b '' c",
+"echo \"say \\\"hi\\\"\"",
+"echo 'it\\'s' one\\ two three",
+"echo 'a|b' \"c>d\" | cat",
+"echo visible # hidden"
+],
+[
+"echo 'mkdir -p zdir' > zygote.sh",
+"echo 'cd zdir' >> zygote.sh",
+"echo 'pwd | sed s,.*/,,' >> zygote.sh",
+"echo 'echo redirected > out.txt' >> zygote.sh",
+"echo 'cat out.txt | tr a-z A-Z' >> zygote.sh",
+"echo 'nosuch_command_xyz || echo missing' >> zygote.sh",
+"sh -c 'CSHELL_ZYGOTE=1 \"$(readlink /proc/$PPID/exe)\" zygote.sh 2>&1'",
+"cat zdir/out.txt"
+],
+[
 "sleep 0.5 && echo 'back sleep is done' &",
 "echo 'next sleep is done'",
 "sleep 0.5",
@@ -0,0 +1,33 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_ARENA_H
+#define SYSPROG_ARENA_H
+
+#include <stddef.h>
+
+typedef struct arena_chunk_s arena_chunk_t;
+
+// Bump allocator for everything parsed out of one input line. Allocations are never freed one by one:
+// the whole arena is reset at once, when the line is done.
+typedef struct arena_s {
+    // The newest, and the largest, chunk comes first.
+    arena_chunk_t* chunks;
+    size_t used;
+    size_t first_chunk_size;
+} arena_t;
+
+void arena_init(arena_t* arena);
+// The same, but the first chunk is first_chunk_size bytes, e.g. for many arenas, which hold a little each.
+void arena_init_sized(arena_t* arena, size_t first_chunk_size);
+
+// Returns: size bytes aligned for any type. Exits if there is no memory, the same as the buffers do.
+void* arena_alloc(arena_t* arena, size_t size);
+
+// Frees everything allocated so far. The largest chunk is kept, so a warmed up arena doesn't call malloc.
+void arena_reset(arena_t* arena);
+
+void arena_destroy(arena_t* arena);
+
+#endif //SYSPROG_ARENA_H
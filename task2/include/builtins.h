@@ -0,0 +1,18 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_BUILTINS_H
+#define SYSPROG_BUILTINS_H
+
+#include "commands.h"
+
+// A builtin runs inside the shell and writes its output to the out descriptor instead of stdout, so it can be
+// redirected without touching the shell's own stdout.
+// Returns: the exit status of the command.
+typedef int (*builtin_func_t)(command_t cmd, int out);
+
+// Returns: the builtin named name, or NULL if it is an external command.
+builtin_func_t find_builtin(const char* name);
+
+#endif //SYSPROG_BUILTINS_H
@@ -18,6 +18,12 @@ typedef struct command_s {
     bool do_append;
     char* redirect_output;
 
+    // Stdin comes from the file redirect_input, or from input_text, which is a here-string or a heredoc body.
+    char* redirect_input;
+    char* input_text;
+    // The body of this heredoc follows the line. It is read into input_text after the line is parsed.
+    char* heredoc_delimiter;
+
     bool pipe_to_next;
 
     bool after_or;
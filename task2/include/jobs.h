@@ -0,0 +1,68 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_JOBS_H
+#define SYSPROG_JOBS_H
+
+#include "commands.h"
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+// Job control. A job is a background pipeline, or a foreground chain, which was stopped. The processes of a job share
+// a process group, so the job is continued or stopped as a whole.
+// Finished jobs are reaped without blocking: SIGCHLD only raises a flag, and the table is updated between lines.
+
+// interactive tells, whether the shell owns the terminal: then it passes the terminal to the foreground jobs and
+// reports about the background ones.
+void jobs_init(bool interactive);
+
+// Forgets the whole table and the terminal, e.g. in a forked background pipeline.
+void jobs_reset_in_child();
+
+// Hands the terminal to the process group, if the shell owns it.
+void jobs_give_terminal_to(pid_t pgid);
+
+// Safe to call from a signal handler.
+void jobs_note_child_event();
+
+// Adds the background process pid, which leads its own process group.
+// Returns: id of the new job.
+int jobs_add_background(pid_t pid, const command_t* commands, size_t count);
+
+// What a process used, known once it is reaped.
+typedef struct process_usage_s {
+    // CLOCK_MONOTONIC time of the reaping, in nanoseconds.
+    uint64_t reaped_ns;
+    struct rusage usage;
+} process_usage_t;
+
+// Adds the process pid, which a builtin runs in the background, e.g. a command of parallel, as a hidden job. Only
+// the builtin waits for it: the job builtins don't list it, and it isn't reported.
+// Returns: id of the new job.
+int jobs_add_hidden(pid_t pid);
+
+// Blocks until a hidden job finishes, and takes it out of the table.
+// Returns: id of the job, or 0 if there are no hidden jobs. *stat receives the wait status of its process.
+int jobs_wait_hidden(int* stat);
+
+// Waits for the foreground chain pids[0, count) in the process group pgid, until all of its processes exit, or one
+// of them stops. A stopped chain becomes a job. A pid of -1 is a process, which couldn't be started.
+// usages[0, count) receives what the processes used, unless it is NULL. It is zeroed, if the chain stopped.
+// Returns: the result of the last process.
+int jobs_wait_foreground(pid_t pgid, const pid_t* pids, size_t count, const command_t* commands, size_t command_count,
+                         process_usage_t* usages);
+
+// Updates the states of the jobs without blocking, if any child changed its state.
+// Finished jobs are reported, if the shell is interactive.
+void jobs_reap();
+
+// Builtins: jobs, wait [-n] [%id|pid ...], fg [%id], bg [%id].
+int jobs_builtin_jobs(command_t cmd, int out);
+int jobs_builtin_wait(command_t cmd, int out);
+int jobs_builtin_fg(command_t cmd, int out);
+int jobs_builtin_bg(command_t cmd, int out);
+
+#endif //SYSPROG_JOBS_H
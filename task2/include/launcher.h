@@ -0,0 +1,21 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_LAUNCHER_H
+#define SYSPROG_LAUNCHER_H
+
+#include "commands.h"
+
+#include <sys/types.h>
+
+// Starts an external command with posix_spawn, which doesn't copy the shell's address space the way fork does.
+// The command is found through the PATH cache. A file without a known format is run by /bin/sh, as execvp does.
+// The command joins the process group pgid, leads a new one if pgid is 0, or stays in the shell's one if it is -1.
+// pipe_in and pipe_out become its stdin and stdout, unless they are -1. unused_end is closed in the command.
+// The output redirection of cmd is applied before the pipes, so a pipe wins over it.
+//
+// Returns: pid of the command, or -1 if it couldn't be started. The reason is printed then.
+pid_t launch_command(command_t cmd, pid_t pgid, int pipe_in, int pipe_out, int unused_end);
+
+#endif //SYSPROG_LAUNCHER_H
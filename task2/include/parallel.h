@@ -0,0 +1,18 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_PARALLEL_H
+#define SYSPROG_PARALLEL_H
+
+#include "commands.h"
+
+// parallel [-j N] command [args ...]: runs the command once for every line of stdin, with the line as its last
+// argument, keeping N commands running at once (the number of CPUs by default).
+// Output of every command is held in memory and printed in the order of the lines, so the outputs never interleave.
+// Every failed command is reported on stderr. The commands are reaped through the shell's job table.
+// Run in the shell on the shell's own stdin, it takes the lines after its own one from the shell's reader.
+// Returns: the number of failed commands, up to 100, or 255 on a usage error.
+int parallel_builtin(command_t cmd, int out);
+
+#endif //SYSPROG_PARALLEL_H
@@ -0,0 +1,41 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_PARSE_CACHE_H
+#define SYSPROG_PARSE_CACHE_H
+
+#include "parser.h"
+
+// Generated scripts and command streams repeat the same lines many times, so every line is parsed once, and its
+// pipelines are taken from the cache afterwards.
+//
+// Lines read from stdin go through a bounded cache. An entry holds its own copy of the line, which the commands point
+// into, in an arena of its own. The cache evicts the least recently used line.
+//
+// Returns: the pipelines of line, the same as parse_line does. The pipelines of a cached line belong to the cache:
+// they mustn't be changed, and stay valid until the next call.
+// A line with a heredoc, whose body differs every time, or a very long one, isn't cached. It is parsed into arena,
+// and the heredoc bodies are read from reader.
+buffer_t parse_cache_parse(const char* line, reader_t* reader, arena_t* arena);
+
+void parse_cache_clear();
+
+// The lines of a script, which is parsed up front. They are kept along with the parsed script in its arena, so there
+// is no bound and no eviction.
+typedef struct script_entry_s script_entry_t;
+typedef struct script_lines_s {
+    arena_t* arena;
+    script_entry_t** buckets;
+    size_t bucket_count;
+    size_t count;
+} script_lines_t;
+
+void script_lines_init(script_lines_t* lines, arena_t* arena);
+
+// Returns: the pipelines of line, the same as parse_line does. A line, which occurred before, isn't parsed again and
+// gets the same pipelines, which mustn't be changed. They live as long as the arena.
+// A line with a heredoc is always parsed, and its heredoc bodies are read from reader.
+buffer_t script_lines_parse(script_lines_t* lines, char* line, reader_t* reader);
+
+#endif //SYSPROG_PARSE_CACHE_H
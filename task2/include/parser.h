@@ -6,14 +6,13 @@
 #define SYSPROG_PARSER_H
 
 #include "shell.h"
+#include "reader.h"
 
 #include <stdio.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <stdlib.h>
 
-char* get_line();
-
 // Parses line and splits it into commands.
 // Commands, then, are grouped into, so called, pipelines.
 // A pipeline entity is used to represent a flow of commands.
@@ -22,7 +21,15 @@ char* get_line();
 // This is done because multiple '&' operations can be used.
 // Each '&' operation makes all ops before it be done in the background mode.
 //
+// Everything, including the returned buffer, is allocated in arena, and lives until the arena is reset.
+// Words are unescaped in place and the commands point right into line, so it has to outlive them too.
+//
 // Returns: array of separate pipelines, or NULL on error.
-buffer_t parse_line(char* line);
+buffer_t parse_line(char* line, arena_t* arena);
+
+// Reads the bodies of the heredocs of the parsed line, which follow it in the reader, into the arena.
+// A body ends at a line, which is exactly its delimiter, or at the end of the input.
+// The reader may move its buffer meanwhile, so the parsed line shouldn't point into it, unless it reads memory.
+void parse_heredocs(buffer_t pipelines, reader_t* reader, arena_t* arena);
 
 #endif //SYSPROG_PARSER_H
@@ -0,0 +1,26 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_PATH_CACHE_H
+#define SYSPROG_PATH_CACHE_H
+
+#include <stdbool.h>
+
+// Remembers, where in PATH every command was found, so PATH is scanned once per command instead of once per launch.
+// The whole cache is dropped as soon as PATH changes.
+
+// Returns: absolute path of the command name, or NULL if it isn't in PATH.
+// Names with a '/' aren't looked up and are returned as is.
+// The returned string is owned by the cache and stays valid until the next call.
+const char* path_cache_lookup(const char* name);
+
+// Drops name from the cache, e.g. once the cached file failed to execute.
+void path_cache_forget(const char* name);
+
+void path_cache_clear();
+
+// Prints to out the cached commands along with the amount of their lookups, the same way 'hash' in other shells does.
+void path_cache_print(int out);
+
+#endif //SYSPROG_PATH_CACHE_H
@@ -0,0 +1,30 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_PIPES_H
+#define SYSPROG_PIPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Pipes between the commands of a chain. A bulk pipeline with the default 64K pipes switches between its
+// stages on every few writes, so the capacity can be raised with 'set -o pipesize N'.
+
+// Sets the capacity of the pipes created from now on. The kernel rounds it up to a power of two pages; 0 brings the
+// default back. Returns false, if the kernel refuses the size, e.g. above /proc/sys/fs/pipe-max-size.
+bool pipes_set_size(size_t size);
+
+// Returns: the capacity of new pipes, or 0 if it is the default one.
+size_t pipes_get_size();
+
+// pipe(2) with the configured capacity.
+int pipes_create(int fds[2]);
+
+// Copies from the current position of from up to its end into to. The bytes are moved inside the kernel:
+// with splice if either side is a pipe, with sendfile otherwise. If neither is possible for these descriptors,
+// they are copied through a buffer.
+// Returns false on a read or write error, which is printed.
+bool pipes_copy(int from, int to);
+
+#endif //SYSPROG_PIPES_H
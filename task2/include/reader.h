@@ -0,0 +1,42 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_READER_H
+#define SYSPROG_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Reads command lines from a descriptor with large read(2) calls and hands them out as slices of its buffer.
+// A line ends at a newline outside of quotes ("", '' and ``). A backslash escapes the next character,
+// and a backslash followed by a newline is removed altogether, so the line continues.
+typedef struct reader_s {
+    int fd;
+    char* buf;
+    size_t capacity;
+    // Bytes [begin, end) of buf are read, but not handed out yet.
+    size_t begin;
+    size_t end;
+    bool eof;
+    // The bytes were given at once, so the buffer isn't the reader's and the last line may lack a newline.
+    bool is_memory;
+    // The input ended inside quotes.
+    bool is_unterminated;
+} reader_t;
+
+void reader_init(reader_t* reader, int fd);
+// Reads lines out of bytes[0, size), e.g. a mapped script. The lines are cut in place, so the bytes have to be
+// writable, including bytes[size].
+void reader_init_memory(reader_t* reader, char* bytes, size_t size);
+void reader_destroy(reader_t* reader);
+
+// Returns: the next line, without the newline and '\0'-terminated, or NULL once the input is over.
+// A line, which isn't finished by the end of the input, is dropped. In memory, only a line inside quotes is.
+// The line stays valid until the next call. It may be modified in place.
+char* reader_next_line(reader_t* reader);
+
+// The same as reader_next_line, but the line ends at the next newline whatever it holds, e.g. in a heredoc body.
+char* reader_next_raw_line(reader_t* reader);
+
+#endif //SYSPROG_READER_H
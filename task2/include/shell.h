@@ -8,12 +8,24 @@
 #include "signal_handlers.h"
 #include "commands.h"
 #include "support.h"
+#include "reader.h"
 
 #include <malloc.h>
 #include <string.h>
 #include <stdio.h>
 
-void run_loop();
+// Reads commands from stdin until it is over.
+// Returns: the result of the last command.
+int run_loop();
+
+// Runs the commands of bytes[0, size) without the interactive setup. bytes[size] has to be writable.
+// The whole script is parsed before it runs.
+// Returns: the result of the last command.
+int run_script(char* bytes, size_t size);
+
+// Returns: the reader of the commands, while a builtin runs in the shell on the shell's own stdin, or NULL.
+// The reader may already hold the lines after the builtin's one, so such a builtin has to read stdin through it.
+reader_t* shell_stdin_reader();
 
 void print_prompt();
 void set_prompt(const char* new_prompt);
@@ -7,6 +7,9 @@
 
 void set_shell_signal_handlers();
 
+// Lets the job table know about children, which changed their state.
+void set_job_signal_handlers();
+
 void set_command_signal_handlers();
 
 #endif //SYSPROG_SIGNAL_HANDLERS_H
@@ -5,6 +5,8 @@
 #ifndef SYSPROG_SUPPORT_H
 #define SYSPROG_SUPPORT_H
 
+#include "arena.h"
+
 #include <unistd.h>
 #include <malloc.h>
 #include <string.h>
@@ -18,14 +20,12 @@ typedef struct {
     size_t count;
     size_t size;
     size_t element_size;
+    // Memory comes from here if not NULL. Such buffer is never freed on its own.
+    arena_t* arena;
 } buffer_t;
 
 buffer_t new_buffer(size_t size_element);
+buffer_t new_arena_buffer(arena_t* arena, size_t size_element);
 void buffer_push_back(buffer_t* buf, const void* element);
 
-void free_pipeline(pipeline_t* pipeline);
-void free_command(command_t* command);
-void free_pipelines(buffer_t pipelines);
-void free_commands(buffer_t cmds);
-
 #endif //SYSPROG_SUPPORT_H
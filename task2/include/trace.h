@@ -0,0 +1,37 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_TRACE_H
+#define SYSPROG_TRACE_H
+
+#include "commands.h"
+#include "jobs.h"
+
+#include <stdint.h>
+
+// Timing of the commands, for the 'time' prefix and for tracing.
+// Tracing is enabled by the CSHELL_TRACE environment variable: "1" traces to stderr, any other value names a file,
+// which the trace is appended to. Every trace line is "cshell_trace" followed by key=value fields.
+
+// Returns: CLOCK_MONOTONIC time in nanoseconds.
+uint64_t trace_now_ns();
+
+bool trace_is_enabled();
+
+// Traces the parsing of a line of len bytes, which started at started_ns and is over now.
+void trace_parse(size_t len, uint64_t started_ns);
+
+// How a stage of a chain was started. pid is -1, if the stage couldn't be started, and 0, if it ran in the shell.
+typedef struct stage_times_s {
+    pid_t pid;
+    uint64_t spawn_started_ns;
+    uint64_t spawned_ns;
+} stage_times_t;
+
+// Reports the finished chain commands[0, count), which the shell started waiting for at wait_started_ns.
+// The times of its stages are printed to stderr, if is_timed, and traced, if tracing is enabled.
+void trace_report_chain(const command_t* commands, size_t count, const stage_times_t* stages,
+                        const process_usage_t* usages, uint64_t wait_started_ns, bool is_timed);
+
+#endif //SYSPROG_TRACE_H
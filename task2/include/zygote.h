@@ -0,0 +1,32 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#ifndef SYSPROG_ZYGOTE_H
+#define SYSPROG_ZYGOTE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Optional spawning helper, enabled by CSHELL_ZYGOTE=1. The zygote is forked at startup, while the shell is small,
+// and starts the external commands on request, so the cost of a start doesn't grow with the shell's memory.
+// Requests carry the path, the arguments, the working directory and the process group over a SOCK_SEQPACKET socket,
+// and the stdin, stdout and stderr of the command as SCM_RIGHTS.
+// The zygote clones the commands with CLONE_PARENT, so they are children of the shell: the shell gets their pids
+// back, and waits for them and controls them the same way as for the ones it spawns itself.
+// Commands get the environment of the shell at startup, which the shell never changes.
+
+// Starts the zygote, if it is enabled.
+void zygote_start();
+
+// Returns: whether commands can be started through the zygote. A forked copy of the shell can't use it, as the
+// commands wouldn't be its children.
+bool zygote_is_running();
+
+// Starts path with args, the same as posix_spawn does. The command joins the process group pgid, leads a new one if
+// pgid is 0, or stays in the shell's one if it is -1. fds become its stdin, stdout and stderr.
+// Returns: 0, or the error of the start, e.g. of exec. -1, if the zygote couldn't take the request, e.g. a too long
+// one; the command should be spawned by the shell then.
+int zygote_spawn(pid_t* pid, const char* path, char** args, pid_t pgid, const int fds[3]);
+
+#endif //SYSPROG_ZYGOTE_H
@@ -0,0 +1,74 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define min_chunk_size (16 * 1024)
+
+struct arena_chunk_s {
+    arena_chunk_t* next;
+    size_t size;
+    alignas(max_align_t) char data[];
+};
+
+void arena_init(arena_t* arena) {
+    arena_init_sized(arena, min_chunk_size);
+}
+
+void arena_init_sized(arena_t* arena, size_t first_chunk_size) {
+    arena->chunks = NULL;
+    arena->used = 0;
+    arena->first_chunk_size = first_chunk_size;
+}
+
+static void add_chunk(arena_t* arena, size_t size) {
+    // Chunks grow geometrically, so a long line takes a few of them, and the next line fits in one.
+    size_t chunk_size = arena->chunks ? arena->chunks->size * 2 : arena->first_chunk_size;
+    if (chunk_size < size) {
+        chunk_size = size;
+    }
+    arena_chunk_t* chunk = malloc(sizeof(arena_chunk_t) + chunk_size);
+    if (!chunk) {
+        perror("Couldn't allocate arena chunk");
+        exit(1);
+    }
+    chunk->next = arena->chunks;
+    chunk->size = chunk_size;
+    arena->chunks = chunk;
+    arena->used = 0;
+}
+
+void* arena_alloc(arena_t* arena, size_t size) {
+    size_t aligned = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    if (!arena->chunks || arena->chunks->size - arena->used < aligned) {
+        add_chunk(arena, aligned);
+    }
+    void* ptr = arena->chunks->data + arena->used;
+    arena->used += aligned;
+    return ptr;
+}
+
+void arena_reset(arena_t* arena) {
+    if (!arena->chunks) {
+        return;
+    }
+    arena_chunk_t* chunk = arena->chunks->next;
+    while (chunk) {
+        arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks->next = NULL;
+    arena->used = 0;
+}
+
+void arena_destroy(arena_t* arena) {
+    arena_reset(arena);
+    free(arena->chunks);
+    arena_init_sized(arena, arena->first_chunk_size);
+}
@@ -0,0 +1,449 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "builtins.h"
+#include "path_cache.h"
+#include "jobs.h"
+#include "parallel.h"
+#include "pipes.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+typedef struct builtin_s {
+    const char* name;
+    builtin_func_t func;
+} builtin_t;
+
+static int exec_cd(command_t cmd, int out) {
+    char* pwd = cmd.args[1];
+    if (pwd == NULL) {
+        pwd = getenv("HOME");
+        if (pwd == NULL) {
+            return 1;
+        }
+    } else if (cmd.args[2]) {
+        return 1;
+    }
+    return chdir(pwd);
+}
+
+static int exec_exit(command_t cmd, int out) {
+    if (cmd.pipe_to_next) {
+        if (cmd.args[1]) {
+            return atoi(cmd.args[1]);
+        }
+        return 0;
+    }
+    if (cmd.args[1]) {
+        exit(atoi(cmd.args[1]));
+    }
+    exit(0);
+}
+
+// hash [-r] [name ...]: lists the cached command paths, clears the cache with -r, or looks the names up.
+static int exec_hash(command_t cmd, int out) {
+    size_t i = 1;
+    if (cmd.args[i] && !strcmp(cmd.args[i], "-r")) {
+        path_cache_clear();
+        i++;
+    } else if (!cmd.args[i]) {
+        path_cache_print(out);
+        return 0;
+    }
+    int result = 0;
+    for (; cmd.args[i]; ++i) {
+        if (!path_cache_lookup(cmd.args[i])) {
+            fprintf(stderr, "hash: %s: not found\n", cmd.args[i]);
+            result = 1;
+        }
+    }
+    return result;
+}
+
+static int exec_true(command_t cmd, int out) {
+    return 0;
+}
+
+static int exec_false(command_t cmd, int out) {
+    return 1;
+}
+
+static bool write_all(int out, const char* bytes, size_t size) {
+    while (size) {
+        ssize_t written = write(out, bytes, size);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+static int exec_pwd(command_t cmd, int out) {
+    char* cwd = getcwd(NULL, 0);
+    if (!cwd) {
+        perror("pwd");
+        return 1;
+    }
+    int ret = dprintf(out, "%s\n", cwd);
+    free(cwd);
+    return ret < 0;
+}
+
+static bool parse_integer(const char* str, long long* val) {
+    char* end;
+    errno = 0;
+    *val = strtoll(str, &end, 10);
+    return end != str && !*end && errno == 0;
+}
+
+#define test_syntax_error (-1)
+// The error was already printed.
+#define test_reported_error (-2)
+
+static int test_unary(const char* op, const char* arg) {
+    struct stat st;
+    if (!strcmp(op, "-n")) {
+        return *arg != '\0';
+    } else if (!strcmp(op, "-z")) {
+        return *arg == '\0';
+    } else if (!strcmp(op, "-e")) {
+        return stat(arg, &st) == 0;
+    } else if (!strcmp(op, "-f")) {
+        return stat(arg, &st) == 0 && S_ISREG(st.st_mode);
+    } else if (!strcmp(op, "-d")) {
+        return stat(arg, &st) == 0 && S_ISDIR(st.st_mode);
+    } else if (!strcmp(op, "-s")) {
+        return stat(arg, &st) == 0 && st.st_size > 0;
+    } else if (!strcmp(op, "-r")) {
+        return access(arg, R_OK) == 0;
+    } else if (!strcmp(op, "-w")) {
+        return access(arg, W_OK) == 0;
+    } else if (!strcmp(op, "-x")) {
+        return access(arg, X_OK) == 0;
+    }
+    return test_syntax_error;
+}
+
+static int test_binary(const char* lhs, const char* op, const char* rhs) {
+    if (!strcmp(op, "=") || !strcmp(op, "==")) {
+        return !strcmp(lhs, rhs);
+    } else if (!strcmp(op, "!=")) {
+        return strcmp(lhs, rhs) != 0;
+    }
+
+    static const char* const int_ops[] = {"-eq", "-ne", "-lt", "-le", "-gt", "-ge"};
+    for (size_t i = 0; i < sizeof(int_ops) / sizeof(int_ops[0]); ++i) {
+        if (strcmp(op, int_ops[i]) != 0) {
+            continue;
+        }
+        long long a, b;
+        if (!parse_integer(lhs, &a) || !parse_integer(rhs, &b)) {
+            fprintf(stderr, "test: integer expression expected\n");
+            return test_reported_error;
+        }
+        int cmp = (a > b) - (a < b);
+        switch (i) {
+            case 0: return cmp == 0;
+            case 1: return cmp != 0;
+            case 2: return cmp < 0;
+            case 3: return cmp <= 0;
+            case 4: return cmp > 0;
+            default: return cmp >= 0;
+        }
+    }
+    return test_syntax_error;
+}
+
+// Evaluates test of up to 4 arguments, the way POSIX defines it by the argument count.
+// Returns: 1 if true, 0 if false, test_syntax_error or test_reported_error.
+static int test_args(char** args, size_t count) {
+    if (count == 0) {
+        return 0;
+    } else if (count == 1) {
+        return *args[0] != '\0';
+    } else if (!strcmp(args[0], "!")) {
+        int result = test_args(args + 1, count - 1);
+        return result < 0 ? result : !result;
+    } else if (count == 2) {
+        return test_unary(args[0], args[1]);
+    } else if (count == 3) {
+        return test_binary(args[0], args[1], args[2]);
+    }
+    return test_syntax_error;
+}
+
+// test expr and [ expr ]: strings, integers and file checks, without -a and -o.
+static int exec_test(command_t cmd, int out) {
+    size_t count = 0;
+    while (cmd.args[count + 1]) {
+        count++;
+    }
+    if (!strcmp(cmd.name, "[")) {
+        if (!count || strcmp(cmd.args[count], "]") != 0) {
+            fprintf(stderr, "[: missing ']'\n");
+            return 2;
+        }
+        count--;
+    }
+    int result = test_args(cmd.args + 1, count);
+    if (result == test_syntax_error) {
+        fprintf(stderr, "%s: syntax error\n", cmd.name);
+    }
+    if (result < 0) {
+        return 2;
+    }
+    return !result;
+}
+
+static void append_bytes(buffer_t* output, const char* bytes, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        buffer_push_back(output, &bytes[i]);
+    }
+}
+
+// Formats one value into output. The spec is built at runtime, so the formatting is delegated to vsnprintf.
+static void append_formatted(buffer_t* output, const char* spec, ...) {
+    char formatted[256];
+    va_list args;
+    va_start(args, spec);
+    int size = vsnprintf(formatted, sizeof(formatted), spec, args);
+    va_end(args);
+    if (size < 0) {
+        return;
+    }
+    if ((size_t)size < sizeof(formatted)) {
+        append_bytes(output, formatted, size);
+        return;
+    }
+    // Wide fields and long strings don't fit the stack.
+    char* long_formatted = malloc(size + 1);
+    if (!long_formatted) {
+        perror("allocation error");
+        exit(1);
+    }
+    va_start(args, spec);
+    vsnprintf(long_formatted, size + 1, spec, args);
+    va_end(args);
+    append_bytes(output, long_formatted, size);
+    free(long_formatted);
+}
+
+// Appends a character of the format, interpreting a backslash escape. Returns the amount of consumed characters.
+static size_t append_escape(buffer_t* output, const char* format) {
+    static const char escapes[] = "n\nt\tr\rv\va\ab\bf\f\\\\";
+    if (format[0] != '\\' || !format[1]) {
+        append_bytes(output, format, 1);
+        return 1;
+    }
+    for (size_t i = 0; escapes[i]; i += 2) {
+        if (format[1] == escapes[i]) {
+            append_bytes(output, &escapes[i + 1], 1);
+            return 2;
+        }
+    }
+    append_bytes(output, format, 2);
+    return 2;
+}
+
+// Parses the options of echo: any mix of n, e and E after a '-', the same as /bin/echo accepts.
+static bool parse_echo_option(const char* arg, bool* print_newline, bool* interpret_escapes) {
+    if (arg[0] != '-' || !arg[1] || strspn(arg + 1, "neE") != strlen(arg + 1)) {
+        return false;
+    }
+    for (const char* c = arg + 1; *c; ++c) {
+        if (*c == 'n') {
+            *print_newline = false;
+        } else {
+            *interpret_escapes = *c == 'e';
+        }
+    }
+    return true;
+}
+
+// echo [-neE] [arg ...]: the same as /bin/echo.
+static int exec_echo(command_t cmd, int out) {
+    size_t i = 1;
+    bool print_newline = true;
+    bool interpret_escapes = false;
+    while (cmd.args[i] && parse_echo_option(cmd.args[i], &print_newline, &interpret_escapes)) {
+        i++;
+    }
+
+    // The whole line goes in one write, so lines of concurrent commands don't interleave.
+    buffer_t line = new_buffer(sizeof(char));
+    for (size_t first = i; cmd.args[i]; ++i) {
+        if (i != first) {
+            append_bytes(&line, " ", 1);
+        }
+        if (!interpret_escapes) {
+            append_bytes(&line, cmd.args[i], strlen(cmd.args[i]));
+            continue;
+        }
+        for (const char* c = cmd.args[i]; *c;) {
+            c += append_escape(&line, c);
+        }
+    }
+    if (print_newline) {
+        append_bytes(&line, "\n", 1);
+    }
+    bool ok = write_all(out, line.buf, line.count);
+    free(line.buf);
+    if (!ok) {
+        perror("echo: write error");
+        return 1;
+    }
+    return 0;
+}
+
+// Appends one conversion of the format, starting at its '%'. Returns the amount of consumed characters.
+static size_t append_conversion(buffer_t* output, const char* format, const char* arg, bool* ok) {
+    size_t len = 1;
+    while (format[len] && strchr("-+ #0123456789.", format[len])) {
+        len++;
+    }
+    char conversion = format[len];
+    if (!conversion) {
+        fprintf(stderr, "printf: missing conversion\n");
+        *ok = false;
+        return len;
+    }
+    len++;
+
+    // The flags, the width and the precision are kept, the conversion gets a fitting length modifier.
+    char spec[64];
+    if (len + 3 > sizeof(spec)) {
+        fprintf(stderr, "printf: too long conversion\n");
+        *ok = false;
+        return len;
+    }
+    memcpy(spec, format, len - 1);
+    spec[len - 1] = '\0';
+    if (conversion == '%') {
+        append_bytes(output, "%", 1);
+    } else if (conversion == 's') {
+        strcat(spec, "s");
+        append_formatted(output, spec, arg ? arg : "");
+    } else if (conversion == 'c') {
+        strcat(spec, "c");
+        append_formatted(output, spec, arg ? arg[0] : '\0');
+    } else if (strchr("diouxX", conversion)) {
+        long long val = 0;
+        if (arg && !parse_integer(arg, &val)) {
+            fprintf(stderr, "printf: %s: invalid number\n", arg);
+            *ok = false;
+        }
+        char length_and_conversion[] = {'l', 'l', conversion, '\0'};
+        strcat(spec, length_and_conversion);
+        if (conversion == 'd' || conversion == 'i') {
+            append_formatted(output, spec, val);
+        } else {
+            append_formatted(output, spec, (unsigned long long)val);
+        }
+    } else {
+        fprintf(stderr, "printf: %%%c: invalid conversion\n", conversion);
+        *ok = false;
+    }
+    return len;
+}
+
+// printf format [arg ...]: the format is reused, while there are arguments left, the same as /usr/bin/printf does.
+static int exec_printf(command_t cmd, int out) {
+    if (!cmd.args[1]) {
+        fprintf(stderr, "printf: missing operand\n");
+        return 1;
+    }
+    const char* format = cmd.args[1];
+    char** args = cmd.args + 2;
+    bool ok = true;
+    buffer_t output = new_buffer(sizeof(char));
+    do {
+        bool used_args = false;
+        for (size_t i = 0; format[i] && ok;) {
+            if (format[i] != '%') {
+                i += append_escape(&output, format + i);
+                continue;
+            }
+            bool takes_arg = format[i + 1] != '%';
+            i += append_conversion(&output, format + i, takes_arg ? *args : NULL, &ok);
+            if (takes_arg && *args) {
+                args++;
+                used_args = true;
+            }
+        }
+        if (!used_args) {
+            break;
+        }
+    } while (*args && ok);
+
+    if (!write_all(out, output.buf, output.count)) {
+        perror("printf: write error");
+        ok = false;
+    }
+    free(output.buf);
+    return ok ? 0 : 1;
+}
+
+// set -o [pipesize N], set +o pipesize: lists the options, sets the capacity of the pipes between commands, or
+// brings the default one back.
+static int exec_set(command_t cmd, int out) {
+    char** args = cmd.args;
+    if (args[1] && !strcmp(args[1], "-o") && !args[2]) {
+        size_t size = pipes_get_size();
+        if (size) {
+            dprintf(out, "pipesize\t%zu\n", size);
+        } else {
+            dprintf(out, "pipesize\tdefault\n");
+        }
+        return 0;
+    }
+    if (!args[1] || !args[2] || strcmp(args[2], "pipesize")) {
+        fprintf(stderr, "set: usage: set -o [pipesize N] | set +o pipesize\n");
+        return 2;
+    }
+    if (!strcmp(args[1], "+o") && !args[3]) {
+        return !pipes_set_size(0);
+    }
+    long long size;
+    if (strcmp(args[1], "-o") || !args[3] || args[4] || !parse_integer(args[3], &size) || size <= 0) {
+        fprintf(stderr, "set: pipesize takes a positive number of bytes\n");
+        return 2;
+    }
+    return !pipes_set_size(size);
+}
+
+static const builtin_t builtins[] = {
+    {"cd", exec_cd},
+    {"exit", exec_exit},
+    {"hash", exec_hash},
+    {"true", exec_true},
+    {"false", exec_false},
+    {"echo", exec_echo},
+    {"pwd", exec_pwd},
+    {"test", exec_test},
+    {"[", exec_test},
+    {"printf", exec_printf},
+    {"jobs", jobs_builtin_jobs},
+    {"wait", jobs_builtin_wait},
+    {"fg", jobs_builtin_fg},
+    {"bg", jobs_builtin_bg},
+    {"parallel", parallel_builtin},
+    {"set", exec_set},
+};
+
+builtin_func_t find_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i) {
+        if (!strcmp(builtins[i].name, name)) {
+            return builtins[i].func;
+        }
+    }
+    return NULL;
+}
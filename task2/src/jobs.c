@@ -0,0 +1,541 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "jobs.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <termios.h>
+
+// Finished jobs are kept for 'wait' and 'jobs' only up to this amount, so fan-out scripts don't grow the table.
+#define max_done_jobs 1024
+
+typedef enum job_state_e {
+    JobRunning,
+    JobStopped,
+    JobDone,
+} job_state_t;
+
+typedef struct job_s {
+    int id;
+    pid_t pgid;
+    pid_t* pids;
+    // Wait statuses of the processes, valid once they exit.
+    int* statuses;
+    bool* is_alive;
+    // Valid once the processes exit, the same as statuses.
+    process_usage_t* usages;
+    size_t count;
+    job_state_t state;
+    // The signal, which stopped the job last.
+    int stop_signal;
+    char* text;
+    // Started by a builtin, which waits for it itself. The job builtins don't see it.
+    bool is_hidden;
+} job_t;
+
+static job_t* jobs = NULL;
+static size_t job_count = 0;
+static size_t job_capacity = 0;
+static bool is_interactive = false;
+static volatile sig_atomic_t has_child_event = 0;
+// Stopped processes are noticed only by the shell itself. A background pipeline waits for its commands until they
+// finish: it is stopped and continued as a whole.
+static int stop_option = WUNTRACED;
+
+void jobs_note_child_event() {
+    has_child_event = 1;
+}
+
+void jobs_init(bool interactive) {
+    is_interactive = interactive;
+}
+
+static void free_job(job_t* job) {
+    free(job->pids);
+    free(job->statuses);
+    free(job->is_alive);
+    free(job->usages);
+    free(job->text);
+}
+
+static void remove_job(size_t index) {
+    free_job(&jobs[index]);
+    memmove(&jobs[index], &jobs[index + 1], (job_count - index - 1) * sizeof(job_t));
+    job_count--;
+}
+
+void jobs_reset_in_child() {
+    while (job_count) {
+        remove_job(job_count - 1);
+    }
+    is_interactive = false;
+    stop_option = 0;
+}
+
+void jobs_give_terminal_to(pid_t pgid) {
+    if (is_interactive) {
+        tcsetpgrp(STDIN_FILENO, pgid);
+    }
+}
+
+static int status_to_result(int stat) {
+    if (WIFSIGNALED(stat)) {
+        return 128 + WTERMSIG(stat);
+    } else if (WIFSTOPPED(stat)) {
+        return 128 + WSTOPSIG(stat);
+    }
+    return WEXITSTATUS(stat);
+}
+
+static void append_text(buffer_t* text, const char* str) {
+    for (; *str; ++str) {
+        buffer_push_back(text, str);
+    }
+}
+
+// Restores the command line of the commands, for listing.
+static char* describe(const command_t* commands, size_t count) {
+    buffer_t text = new_buffer(sizeof(char));
+    for (size_t i = 0; i < count; ++i) {
+        if (commands[i].after_and) {
+            append_text(&text, "&& ");
+        } else if (commands[i].after_or) {
+            append_text(&text, "|| ");
+        }
+        for (size_t j = 0; commands[i].args[j]; ++j) {
+            append_text(&text, commands[i].args[j]);
+            append_text(&text, " ");
+        }
+        if (commands[i].heredoc_delimiter) {
+            append_text(&text, "<< ");
+            append_text(&text, commands[i].heredoc_delimiter);
+            append_text(&text, " ");
+        } else if (commands[i].input_text) {
+            append_text(&text, "<<< ... ");
+        } else if (commands[i].redirect_input) {
+            append_text(&text, "< ");
+            append_text(&text, commands[i].redirect_input);
+            append_text(&text, " ");
+        }
+        if (commands[i].redirect_output) {
+            append_text(&text, commands[i].do_append ? ">> " : "> ");
+            append_text(&text, commands[i].redirect_output);
+            append_text(&text, " ");
+        }
+        if (commands[i].pipe_to_next) {
+            append_text(&text, "| ");
+        }
+    }
+    if (text.count) {
+        text.count--;
+    }
+    char guard = '\0';
+    buffer_push_back(&text, &guard);
+    return text.buf;
+}
+
+// A job is done, once none of its processes is alive.
+static void refresh_state(job_t* job) {
+    for (size_t i = 0; i < job->count; ++i) {
+        if (job->is_alive[i]) {
+            return;
+        }
+    }
+    job->state = JobDone;
+}
+
+static job_t* add_job(pid_t pgid, const pid_t* pids, size_t count, job_state_t state, char* text) {
+    // The oldest finished jobs, which nobody asked about, are dropped.
+    size_t done_count = 0;
+    for (size_t i = 0; i < job_count; ++i) {
+        done_count += jobs[i].state == JobDone && !jobs[i].is_hidden;
+    }
+    for (size_t i = 0; i < job_count && done_count >= max_done_jobs;) {
+        if (jobs[i].state == JobDone && !jobs[i].is_hidden) {
+            remove_job(i);
+            done_count--;
+        } else {
+            i++;
+        }
+    }
+
+    if (job_count == job_capacity) {
+        size_t capacity = job_capacity ? job_capacity * 2 : 8;
+        job_t* new_jobs = realloc(jobs, capacity * sizeof(job_t));
+        if (!new_jobs) {
+            perror("Couldn't reallocate memory.");
+            exit(1);
+        }
+        jobs = new_jobs;
+        job_capacity = capacity;
+    }
+
+    job_t* job = &jobs[job_count];
+    job->id = job_count ? jobs[job_count - 1].id + 1 : 1;
+    job->pgid = pgid;
+    job->count = count;
+    job->pids = calloc(count, sizeof(pid_t));
+    job->statuses = calloc(count, sizeof(int));
+    job->is_alive = calloc(count, sizeof(bool));
+    job->usages = calloc(count, sizeof(process_usage_t));
+    if (!job->pids || !job->statuses || !job->is_alive || !job->usages) {
+        perror("allocation error");
+        exit(1);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        job->pids[i] = pids[i];
+        job->is_alive[i] = pids[i] > 0;
+        job->statuses[i] = 1 << 8;
+    }
+    job->state = state;
+    job->stop_signal = 0;
+    job->text = text;
+    job->is_hidden = false;
+    refresh_state(job);
+    job_count++;
+    return job;
+}
+
+int jobs_add_background(pid_t pid, const command_t* commands, size_t count) {
+    job_t* job = add_job(pid, &pid, 1, JobRunning, describe(commands, count));
+    if (is_interactive) {
+        fprintf(stderr, "[%d] %d\n", job->id, (int)pid);
+    }
+    return job->id;
+}
+
+int jobs_add_hidden(pid_t pid) {
+    job_t* job = add_job(-1, &pid, 1, JobRunning, NULL);
+    job->is_hidden = true;
+    return job->id;
+}
+
+// Records the new status of pid, and what it used, if it exited. Returns false, if pid isn't in the job.
+static bool update_job(job_t* job, pid_t pid, int stat, const struct rusage* usage) {
+    for (size_t i = 0; i < job->count; ++i) {
+        if (job->pids[i] != pid) {
+            continue;
+        }
+        if (WIFSTOPPED(stat)) {
+            job->state = JobStopped;
+            job->stop_signal = WSTOPSIG(stat);
+        } else if (WIFCONTINUED(stat)) {
+            job->state = JobRunning;
+        } else {
+            job->statuses[i] = stat;
+            job->is_alive[i] = false;
+            job->usages[i].reaped_ns = trace_now_ns();
+            job->usages[i].usage = *usage;
+        }
+        refresh_state(job);
+        return true;
+    }
+    return false;
+}
+
+static int job_result(const job_t* job) {
+    return status_to_result(job->statuses[job->count - 1]);
+}
+
+static const char* state_text(const job_t* job) {
+    switch (job->state) {
+        case JobRunning:
+            return "Running";
+        case JobStopped:
+            return "Stopped";
+        case JobDone:
+            return job_result(job) ? "Exit" : "Done";
+    }
+    return "";
+}
+
+static void print_job(const job_t* job, int out) {
+    dprintf(out, "[%d]%c  %-8s %s\n", job->id, job == &jobs[job_count - 1] ? '+' : ' ', state_text(job), job->text);
+}
+
+// Waits for the process of the job at index. If the job has a group of its own, any process of the group, which
+// changes its state first, is taken instead, so the processes are reaped in the order they exit, and the exit times
+// are exact.
+// Returns: false, if waiting failed.
+static bool wait_job_process(job_t* job, size_t index, int options) {
+    int stat;
+    struct rusage usage;
+    pid_t ret;
+    pid_t pid = job->pgid > 0 ? -job->pgid : job->pids[index];
+    while ((ret = wait4(pid, &stat, options, &usage)) == -1 && errno == EINTR) {
+    }
+    if (ret == -1) {
+        // The processes were reaped elsewhere, so their statuses are lost.
+        for (size_t i = 0; i < job->count; ++i) {
+            if (pid < 0 || i == index) {
+                job->is_alive[i] = false;
+            }
+        }
+        refresh_state(job);
+        return false;
+    }
+    if (ret > 0) {
+        update_job(job, ret, stat, &usage);
+    }
+    return true;
+}
+
+static void poll_jobs() {
+    has_child_event = 0;
+    for (size_t i = 0; i < job_count; ++i) {
+        for (size_t j = 0; j < jobs[i].count; ++j) {
+            if (jobs[i].is_alive[j]) {
+                wait_job_process(&jobs[i], j, WNOHANG | WUNTRACED | WCONTINUED);
+            }
+        }
+    }
+}
+
+void jobs_reap() {
+    if (!has_child_event) {
+        return;
+    }
+    poll_jobs();
+    if (!is_interactive) {
+        return;
+    }
+    for (size_t i = 0; i < job_count;) {
+        if (jobs[i].state == JobDone && !jobs[i].is_hidden) {
+            print_job(&jobs[i], STDERR_FILENO);
+            remove_job(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// Blocks until the job finishes or stops. A finished job leaves the table.
+// Returns: the result of the job.
+// usages receives what the processes used, if it isn't NULL and the job finishes.
+static int wait_job(size_t index, bool* is_stopped, process_usage_t* usages) {
+    job_t* job = &jobs[index];
+    for (size_t i = 0; i < job->count && job->state != JobStopped; ++i) {
+        while (job->is_alive[i] && job->state != JobStopped && wait_job_process(job, i, stop_option)) {
+        }
+    }
+    *is_stopped = job->state == JobStopped;
+    if (*is_stopped) {
+        return 128 + job->stop_signal;
+    }
+    int result = job_result(job);
+    if (usages) {
+        memcpy(usages, job->usages, job->count * sizeof(process_usage_t));
+    }
+    remove_job(index);
+    return result;
+}
+
+int jobs_wait_foreground(pid_t pgid, const pid_t* pids, size_t count, const command_t* commands, size_t command_count,
+                         process_usage_t* usages) {
+    job_t* job = add_job(pgid, pids, count, JobRunning, NULL);
+    size_t index = job - jobs;
+    bool is_stopped;
+    if (usages) {
+        memset(usages, 0, count * sizeof(process_usage_t));
+    }
+    int result = wait_job(index, &is_stopped, usages);
+    if (is_stopped) {
+        jobs[index].text = describe(commands, command_count);
+        if (is_interactive) {
+            fprintf(stderr, "\n");
+            print_job(&jobs[index], STDERR_FILENO);
+        }
+    }
+    return result;
+}
+
+// Finds the job given as %id, or as the pid of its process. NULL arg means the latest job.
+// Returns: index of the job, or job_count if there is no such job, or arg isn't a number.
+static size_t find_job(const char* arg) {
+    if (!arg) {
+        return job_count ? job_count - 1 : 0;
+    }
+    bool by_id = arg[0] == '%';
+    char* end = NULL;
+    long val = strtol(arg + by_id, &end, 10);
+    if (end == arg + by_id || *end) {
+        return job_count;
+    }
+    for (size_t i = 0; i < job_count; ++i) {
+        if (!jobs[i].is_hidden && (by_id ? jobs[i].id == val : jobs[i].pids[0] == val)) {
+            return i;
+        }
+    }
+    return job_count;
+}
+
+int jobs_builtin_jobs(command_t cmd, int out) {
+    // The statuses are brought up to date first, without waiting for a signal.
+    poll_jobs();
+
+    for (size_t i = 0; i < job_count;) {
+        if (jobs[i].is_hidden) {
+            i++;
+            continue;
+        }
+        print_job(&jobs[i], out);
+        if (jobs[i].state == JobDone) {
+            remove_job(i);
+        } else {
+            i++;
+        }
+    }
+    return 0;
+}
+
+// Blocks until any child changes its state, and records it in its job.
+// No foreground command runs, while the shell is in a builtin, so any child is a job.
+// Returns: false, if there are no children to wait for.
+static bool wait_any_child() {
+    int stat;
+    struct rusage usage;
+    pid_t pid;
+    while ((pid = wait4(-1, &stat, stop_option, &usage)) == -1 && errno == EINTR) {
+    }
+    if (pid == -1) {
+        return false;
+    }
+    for (size_t i = 0; i < job_count && !update_job(&jobs[i], pid, stat, &usage); ++i) {
+    }
+    return true;
+}
+
+// Waits for any running job to finish. Returns its result, or 127 if there are no running jobs.
+static int wait_any() {
+    while (true) {
+        bool has_running = false;
+        for (size_t i = 0; i < job_count; ++i) {
+            if (jobs[i].is_hidden) {
+                continue;
+            }
+            if (jobs[i].state == JobDone) {
+                bool is_stopped;
+                return wait_job(i, &is_stopped, NULL);
+            }
+            has_running = has_running || jobs[i].state == JobRunning;
+        }
+        if (!has_running || !wait_any_child()) {
+            return 127;
+        }
+    }
+}
+
+int jobs_wait_hidden(int* stat) {
+    while (true) {
+        bool has_hidden = false;
+        for (size_t i = 0; i < job_count; ++i) {
+            if (!jobs[i].is_hidden) {
+                continue;
+            }
+            if (jobs[i].state == JobDone) {
+                int id = jobs[i].id;
+                *stat = jobs[i].statuses[0];
+                remove_job(i);
+                return id;
+            }
+            has_hidden = true;
+        }
+        if (!has_hidden) {
+            return 0;
+        }
+        if (!wait_any_child()) {
+            // The processes were reaped elsewhere, so they fail with their statuses lost.
+            for (size_t i = 0; i < job_count; ++i) {
+                if (jobs[i].is_hidden) {
+                    jobs[i].is_alive[0] = false;
+                    refresh_state(&jobs[i]);
+                }
+            }
+        }
+    }
+}
+
+int jobs_builtin_wait(command_t cmd, int out) {
+    char** args = cmd.args;
+    if (args[1] && !strcmp(args[1], "-n")) {
+        return wait_any();
+    }
+    bool is_stopped;
+    if (!args[1]) {
+        // Stopped jobs would never finish, so they are left in the table.
+        for (size_t i = 0; i < job_count;) {
+            if (jobs[i].is_hidden) {
+                i++;
+                continue;
+            }
+            wait_job(i, &is_stopped, NULL);
+            i += is_stopped;
+        }
+        return 0;
+    }
+
+    int result = 0;
+    for (size_t i = 1; args[i]; ++i) {
+        size_t index = find_job(args[i]);
+        if (index == job_count) {
+            fprintf(stderr, "wait: %s: no such job\n", args[i]);
+            result = 127;
+            continue;
+        }
+        result = wait_job(index, &is_stopped, NULL);
+    }
+    return result;
+}
+
+// Signals every process of the job: the whole group, if it has one of its own.
+static void continue_job(job_t* job) {
+    if (job->pgid > 0) {
+        kill(-job->pgid, SIGCONT);
+    } else {
+        for (size_t i = 0; i < job->count; ++i) {
+            if (job->is_alive[i]) {
+                kill(job->pids[i], SIGCONT);
+            }
+        }
+    }
+    if (job->state == JobStopped) {
+        job->state = JobRunning;
+    }
+}
+
+int jobs_builtin_fg(command_t cmd, int out) {
+    char** args = cmd.args;
+    size_t index = find_job(args[1]);
+    if (index == job_count) {
+        fprintf(stderr, "fg: %s: no such job\n", args[1] ? args[1] : "current");
+        return 1;
+    }
+    dprintf(out, "%s\n", jobs[index].text);
+    jobs_give_terminal_to(jobs[index].pgid);
+    continue_job(&jobs[index]);
+    bool is_stopped;
+    int result = wait_job(index, &is_stopped, NULL);
+    jobs_give_terminal_to(getpgrp());
+    if (is_stopped && is_interactive) {
+        fprintf(stderr, "\n");
+        print_job(&jobs[index], STDERR_FILENO);
+    }
+    return result;
+}
+
+int jobs_builtin_bg(command_t cmd, int out) {
+    char** args = cmd.args;
+    size_t index = find_job(args[1]);
+    if (index == job_count) {
+        fprintf(stderr, "bg: %s: no such job\n", args[1] ? args[1] : "current");
+        return 1;
+    }
+    continue_job(&jobs[index]);
+    dprintf(out, "[%d] %s &\n", jobs[index].id, jobs[index].text);
+    return 0;
+}
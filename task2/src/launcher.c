@@ -0,0 +1,171 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "launcher.h"
+#include "path_cache.h"
+#include "zygote.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <paths.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern char **environ;
+
+static bool add_fd_actions(posix_spawn_file_actions_t *actions, int redirect_fd,
+                           int pipe_in, int pipe_out, int unused_end) {
+    int ret = 0;
+    if (unused_end != -1) {
+        ret = ret ? ret : posix_spawn_file_actions_addclose(actions, unused_end);
+    }
+    if (redirect_fd != -1) {
+        ret = ret ? ret : posix_spawn_file_actions_adddup2(actions, redirect_fd, STDOUT_FILENO);
+    }
+    if (pipe_in != -1) {
+        ret = ret ? ret : posix_spawn_file_actions_adddup2(actions, pipe_in, STDIN_FILENO);
+        ret = ret ? ret : posix_spawn_file_actions_addclose(actions, pipe_in);
+    }
+    if (pipe_out != -1) {
+        ret = ret ? ret : posix_spawn_file_actions_adddup2(actions, pipe_out, STDOUT_FILENO);
+        ret = ret ? ret : posix_spawn_file_actions_addclose(actions, pipe_out);
+    }
+    if (ret) {
+        errno = ret;
+        perror("Couldn't prepare file actions");
+        return false;
+    }
+    return true;
+}
+
+// The shell ignores some signals for itself. Commands get the default handling back.
+static bool set_attributes(posix_spawnattr_t *attr, pid_t pgid) {
+    sigset_t default_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGTTOU);
+    sigaddset(&default_signals, SIGTSTP);
+    sigset_t mask;
+    sigemptyset(&mask);
+
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK | (pgid != -1 ? POSIX_SPAWN_SETPGROUP : 0);
+    int ret = posix_spawnattr_setflags(attr, flags);
+    ret = ret ? ret : posix_spawnattr_setpgroup(attr, pgid != -1 ? pgid : 0);
+    ret = ret ? ret : posix_spawnattr_setsigdefault(attr, &default_signals);
+    ret = ret ? ret : posix_spawnattr_setsigmask(attr, &mask);
+    if (ret) {
+        errno = ret;
+        perror("Couldn't prepare spawn attributes");
+        return false;
+    }
+    return true;
+}
+
+// How a command is started: through the zygote, if it runs, or with posix_spawn.
+typedef struct spawn_setup_s {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    pid_t pgid;
+    // Stdin, stdout and stderr of the command, for the zygote.
+    int fds[3];
+} spawn_setup_t;
+
+static int spawn_file(pid_t *pid, const char *path, char **args, spawn_setup_t *setup) {
+    if (zygote_is_running()) {
+        int ret = zygote_spawn(pid, path, args, setup->pgid, setup->fds);
+        if (ret != -1) {
+            return ret;
+        }
+    }
+    return posix_spawn(pid, path, &setup->actions, &setup->attr, args, environ);
+}
+
+// Unlike execvp, posix_spawn doesn't run a file without a known format as a script,
+// so it is passed to /bin/sh here, the same way execvp did it.
+static int spawn_path(pid_t *pid, const char *path, char **args, spawn_setup_t *setup) {
+    int ret = spawn_file(pid, path, args, setup);
+    if (ret != ENOEXEC) {
+        return ret;
+    }
+    size_t arg_count = 0;
+    while (args[arg_count]) {
+        ++arg_count;
+    }
+    char **script_args = malloc((arg_count + 2) * sizeof(char *));
+    if (!script_args) {
+        perror("Couldn't allocate arguments");
+        exit(1);
+    }
+    script_args[0] = (char *) _PATH_BSHELL;
+    script_args[1] = (char *) path;
+    for (size_t i = 1; i <= arg_count; ++i) {
+        script_args[i + 1] = args[i];
+    }
+    ret = spawn_file(pid, _PATH_BSHELL, script_args, setup);
+    free(script_args);
+    return ret;
+}
+
+// Spawns cmd by its cached path. If the cached file is gone, PATH is scanned once more.
+// Returns: 0, or the error of posix_spawn.
+static int spawn_resolved(pid_t *pid, command_t cmd, spawn_setup_t *setup) {
+    const char *path = path_cache_lookup(cmd.name);
+    if (!path) {
+        return ENOENT;
+    }
+    int ret = spawn_path(pid, path, cmd.args, setup);
+    if ((ret == ENOENT || ret == EACCES) && path != cmd.name) {
+        path_cache_forget(cmd.name);
+        path = path_cache_lookup(cmd.name);
+        if (!path) {
+            return ENOENT;
+        }
+        ret = spawn_path(pid, path, cmd.args, setup);
+        if (ret) {
+            path_cache_forget(cmd.name);
+        }
+    }
+    return ret;
+}
+
+pid_t launch_command(command_t cmd, pid_t pgid, int pipe_in, int pipe_out, int unused_end) {
+    // The file is opened by the shell itself, so a failure is reported the same way, as it was with fork.
+    int redirect_fd = -1;
+    if (cmd.redirect_output != NULL) {
+        redirect_fd = open(cmd.redirect_output,
+                           O_WRONLY | O_CREAT | O_CLOEXEC | (cmd.do_append ? O_APPEND : O_TRUNC), 0655);
+        if (redirect_fd == -1) {
+            perror("Couldn't open file");
+            return -1;
+        }
+    }
+
+    // The zygote gets the resulting descriptors right away. A pipe wins over the redirection here too.
+    spawn_setup_t setup = {.pgid = pgid, .fds = {pipe_in != -1 ? pipe_in : STDIN_FILENO,
+                                                 pipe_out != -1 ? pipe_out : redirect_fd, STDERR_FILENO}};
+    if (setup.fds[1] == -1) {
+        setup.fds[1] = STDOUT_FILENO;
+    }
+    posix_spawn_file_actions_init(&setup.actions);
+    posix_spawnattr_init(&setup.attr);
+
+    pid_t pid = -1;
+    if (add_fd_actions(&setup.actions, redirect_fd, pipe_in, pipe_out, unused_end)
+        && set_attributes(&setup.attr, pgid)) {
+        int ret = spawn_resolved(&pid, cmd, &setup);
+        if (ret) {
+            errno = ret;
+            perror("exec error");
+            pid = -1;
+        }
+    }
+
+    posix_spawnattr_destroy(&setup.attr);
+    posix_spawn_file_actions_destroy(&setup.actions);
+    if (redirect_fd != -1) {
+        close(redirect_fd);
+    }
+    return pid;
+}
@@ -4,15 +4,73 @@
 
 #include "shell.h"
 
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void print_usage() {
+    printf("Usage: ./Cshell [--prompt prompt_str]\n"
+           "       ./Cshell script [args ...]\n"
+           "       ./Cshell -c command_line [name [args ...]]\n");
+}
+
+// Maps the script privately, so that its lines can be cut in place, with one more writable byte after its end.
+// Returns: the script bytes, or NULL on error.
+static char* map_script(const char* file, size_t* size) {
+    int fd = open(file, O_RDONLY);
+    if (fd == -1) {
+        perror(file);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror(file);
+        close(fd);
+        return NULL;
+    }
+    *size = st.st_size;
+
+    // The file goes over an anonymous mapping, which provides the extra byte even if the file ends on a page
+    // boundary.
+    char* bytes = mmap(NULL, *size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bytes != MAP_FAILED && *size
+        && mmap(bytes, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(bytes, *size + 1);
+        bytes = MAP_FAILED;
+    }
+    close(fd);
+    if (bytes == MAP_FAILED) {
+        perror(file);
+        return NULL;
+    }
+    return bytes;
+}
 
 int main(int argc, char** argv) {
     if (argc > 2 && strcmp(argv[1], "--prompt") == 0) {
         set_prompt(argv[2]);
     } else if (argc > 1 && (!strcmp(argv[1], "--help") || !strcmp(argv[1], "-h"))) {
-        printf("Usage: ./Cshell [--prompt prompt_str]\n");
+        print_usage();
         return 0;
+    } else if (argc > 1 && !strcmp(argv[1], "-c")) {
+        if (argc < 3) {
+            print_usage();
+            return 2;
+        }
+        // Arguments are writable and '\0'-terminated, so the command line can be run in place.
+        return run_script(argv[2], strlen(argv[2]));
+    } else if (argc > 1) {
+        // There is no parameter expansion, so the script arguments are accepted, but not used.
+        size_t size;
+        char* bytes = map_script(argv[1], &size);
+        if (!bytes) {
+            return 127;
+        }
+        int result = run_script(bytes, size);
+        munmap(bytes, size + 1);
+        return result;
     }
 
-    run_loop();
+    return run_loop();
 }
@@ -0,0 +1,249 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "parallel.h"
+#include "jobs.h"
+#include "launcher.h"
+#include "pipes.h"
+#include "shell.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// Commands may finish ahead of the first unprinted one only up to this many per slot, which bounds held outputs.
+#define parallel_window_per_slot 4
+#define parallel_read_size (64 * 1024)
+#define max_parallel_slots 1024
+#define max_reported_failures 100
+
+typedef struct parallel_job_s {
+    pid_t pid;
+    // The hidden job of the command in the shell's job table.
+    int id;
+    // Stdout of the command, held until the commands before it are printed.
+    int output;
+    int stat;
+    bool is_running;
+    char* line;
+} parallel_job_t;
+
+typedef struct parallel_s {
+    // Ring of the commands, which are started, but not printed yet.
+    parallel_job_t* jobs;
+    size_t window;
+    size_t started;
+    size_t printed;
+    size_t running;
+    size_t failed;
+} parallel_t;
+
+// Lines of stdin. Unlike the command lines, quotes and backslashes mean nothing here.
+typedef struct line_source_s {
+    // The shell's reader of the commands, if parallel runs on the shell's stdin. Then the lines come from it.
+    reader_t* commands;
+    int fd;
+    char* buf;
+    size_t capacity;
+    size_t begin;
+    size_t end;
+    bool eof;
+} line_source_t;
+
+static void print_usage() {
+    fprintf(stderr, "Usage: parallel [-j N] command [args ...]\n");
+}
+
+// Returns: the next line of the input, without the newline, which the caller has to free, or NULL once it is over.
+static char* next_line(line_source_t* source) {
+    if (source->commands) {
+        char* command_line = reader_next_raw_line(source->commands);
+        char* line = command_line ? strdup(command_line) : NULL;
+        if (command_line && !line) {
+            perror("allocation error");
+            exit(1);
+        }
+        return line;
+    }
+    while (true) {
+        char* begin = source->buf + source->begin;
+        char* newline = memchr(begin, '\n', source->end - source->begin);
+        if (newline || (source->eof && source->begin < source->end)) {
+            size_t len = newline ? (size_t)(newline - begin) : source->end - source->begin;
+            source->begin += len + (newline != NULL);
+            char* line = strndup(begin, len);
+            if (!line) {
+                perror("allocation error");
+                exit(1);
+            }
+            return line;
+        }
+        if (source->eof) {
+            return NULL;
+        }
+
+        memmove(source->buf, begin, source->end - source->begin);
+        source->end -= source->begin;
+        source->begin = 0;
+        if (source->capacity - source->end < parallel_read_size) {
+            source->capacity = source->end + parallel_read_size;
+            source->buf = realloc(source->buf, source->capacity);
+            if (!source->buf) {
+                perror("Couldn't reallocate memory.");
+                exit(1);
+            }
+        }
+        ssize_t bytes_read = read(source->fd, source->buf + source->end, source->capacity - source->end);
+        if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        } else if (bytes_read == -1) {
+            perror("parallel: read error");
+        }
+        if (bytes_read <= 0) {
+            source->eof = true;
+        } else {
+            source->end += bytes_read;
+        }
+    }
+}
+
+static int status_to_result(int stat) {
+    if (WIFSIGNALED(stat)) {
+        return 128 + WTERMSIG(stat);
+    }
+    return WEXITSTATUS(stat);
+}
+
+// Starts cmd with the line as its last argument. The command reads /dev/null, so it doesn't eat the lines meant for
+// the next ones.
+static void start_job(parallel_job_t* job, command_t cmd, size_t line_arg, char* line, int null_fd) {
+    job->line = line;
+    job->pid = -1;
+    job->id = 0;
+    job->is_running = false;
+    // A command, which couldn't be started, fails the way an unknown one does.
+    job->stat = 127 << 8;
+
+    job->output = memfd_create("parallel_output", MFD_CLOEXEC);
+    if (job->output == -1) {
+        perror("parallel: memfd_create error");
+        return;
+    }
+    cmd.args[line_arg] = line;
+    job->pid = launch_command(cmd, -1, null_fd, job->output, -1);
+    if (job->pid == -1) {
+        return;
+    }
+    job->is_running = true;
+    job->id = jobs_add_hidden(job->pid);
+}
+
+// Blocks until one of the running commands exits, and reaps it through the job table.
+static void wait_for_any(parallel_t* parallel) {
+    int stat = 1 << 8;
+    int id = jobs_wait_hidden(&stat);
+    for (size_t i = parallel->printed; i < parallel->started; ++i) {
+        parallel_job_t* job = &parallel->jobs[i % parallel->window];
+        // Without any hidden jobs left, the commands are lost, so all of them fail.
+        if (job->is_running && (job->id == id || !id)) {
+            job->stat = stat;
+            job->is_running = false;
+            parallel->running--;
+        }
+    }
+}
+
+// Prints the finished commands, which are next in the order of the lines.
+static void print_finished(parallel_t* parallel, int out) {
+    while (parallel->printed < parallel->started) {
+        parallel_job_t* job = &parallel->jobs[parallel->printed % parallel->window];
+        if (job->is_running) {
+            return;
+        }
+        if (job->output != -1) {
+            lseek(job->output, 0, SEEK_SET);
+            pipes_copy(job->output, out);
+            close(job->output);
+        }
+        int result = status_to_result(job->stat);
+        if (result) {
+            fprintf(stderr, "parallel: %s: exited with %d\n", job->line, result);
+            parallel->failed++;
+        }
+        free(job->line);
+        parallel->printed++;
+    }
+}
+
+int parallel_builtin(command_t cmd, int out) {
+    size_t first = 1;
+    long slot_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cmd.args[1] && !strcmp(cmd.args[1], "-j")) {
+        char* end = NULL;
+        slot_count = cmd.args[2] ? strtol(cmd.args[2], &end, 10) : 0;
+        if (!cmd.args[2] || *end || slot_count <= 0 || slot_count > max_parallel_slots) {
+            fprintf(stderr, "parallel: -j takes a number in [1, %d]\n", max_parallel_slots);
+            return 255;
+        }
+        first = 3;
+    }
+    if (!cmd.args[first]) {
+        print_usage();
+        return 255;
+    }
+    slot_count = slot_count > 0 ? slot_count : 1;
+
+    // The command gets a copy of the arguments with a slot for the line.
+    size_t arg_count = 0;
+    while (cmd.args[first + arg_count]) {
+        arg_count++;
+    }
+    command_t job_cmd = {.name = cmd.args[first], .args = calloc(arg_count + 2, sizeof(char*)), .do_append = false,
+                         .redirect_output = NULL, .pipe_to_next = false, .after_or = false, .after_and = false};
+    parallel_t parallel = {.window = slot_count * parallel_window_per_slot, .started = 0, .printed = 0,
+                           .running = 0, .failed = 0};
+    parallel.jobs = calloc(parallel.window, sizeof(parallel_job_t));
+    if (!job_cmd.args || !parallel.jobs) {
+        perror("allocation error");
+        exit(1);
+    }
+    memcpy(job_cmd.args, &cmd.args[first], arg_count * sizeof(char*));
+
+    int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    line_source_t source = {.commands = shell_stdin_reader(), .fd = STDIN_FILENO, .buf = malloc(parallel_read_size),
+                            .capacity = parallel_read_size, .begin = 0, .end = 0, .eof = false};
+    if (!source.buf) {
+        perror("allocation error");
+        exit(1);
+    }
+    bool has_input = true;
+    while (has_input || parallel.running) {
+        while (has_input && parallel.running < (size_t)slot_count
+               && parallel.started - parallel.printed < parallel.window) {
+            char* line = next_line(&source);
+            if (!line) {
+                has_input = false;
+                break;
+            }
+            parallel_job_t* job = &parallel.jobs[parallel.started % parallel.window];
+            start_job(job, job_cmd, arg_count, line, null_fd);
+            parallel.started++;
+            parallel.running += job->is_running;
+        }
+        if (parallel.running) {
+            wait_for_any(&parallel);
+        }
+        print_finished(&parallel, out);
+    }
+
+    if (null_fd != -1) {
+        close(null_fd);
+    }
+    free(source.buf);
+    free(parallel.jobs);
+    free(job_cmd.args);
+    return parallel.failed < max_reported_failures ? (int)parallel.failed : max_reported_failures;
+}
@@ -0,0 +1,221 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "parse_cache.h"
+
+#include <stdint.h>
+
+#define parse_cache_capacity 1024
+#define cache_bucket_count 2048
+// Longer lines are seldom repeated, and would make the cache large.
+#define max_cached_line 4096
+// An entry holds one line, so its arena starts small instead of with a full chunk.
+#define entry_first_chunk 1024
+#define script_initial_buckets 256
+
+typedef struct entry_s {
+    uint64_t hash;
+    // The line as it was read. The pipelines point into a copy, which is unescaped in place.
+    char* line;
+    buffer_t pipelines;
+    arena_t arena;
+    struct entry_s* next_in_bucket;
+    // Neighbours in the order of use.
+    struct entry_s* newer;
+    struct entry_s* older;
+} entry_t;
+
+static entry_t* buckets[cache_bucket_count];
+static entry_t* newest = NULL;
+static entry_t* oldest = NULL;
+static size_t entry_count = 0;
+
+static uint64_t hash_line(const char* line) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *line; ++line) {
+        hash ^= (unsigned char)*line;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static char* copy_line(const char* line, size_t len, arena_t* arena) {
+    char* copy = arena_alloc(arena, len + 1);
+    memcpy(copy, line, len + 1);
+    return copy;
+}
+
+static void unlink_from_order(entry_t* entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        oldest = entry->newer;
+    }
+}
+
+static void link_as_newest(entry_t* entry) {
+    entry->newer = NULL;
+    entry->older = newest;
+    if (newest) {
+        newest->newer = entry;
+    } else {
+        oldest = entry;
+    }
+    newest = entry;
+}
+
+static void remove_entry(entry_t* entry) {
+    entry_t** slot = &buckets[entry->hash % cache_bucket_count];
+    while (*slot != entry) {
+        slot = &(*slot)->next_in_bucket;
+    }
+    *slot = entry->next_in_bucket;
+    unlink_from_order(entry);
+    arena_destroy(&entry->arena);
+    free(entry);
+    entry_count--;
+}
+
+void parse_cache_clear() {
+    while (oldest) {
+        remove_entry(oldest);
+    }
+}
+
+static entry_t* find_entry(const char* line, uint64_t hash) {
+    for (entry_t* entry = buckets[hash % cache_bucket_count]; entry; entry = entry->next_in_bucket) {
+        if (entry->hash == hash && !strcmp(entry->line, line)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Parses line into a new entry. Returns: the entry, or NULL on a syntax error, which isn't cached.
+static entry_t* add_entry(const char* line, size_t len, uint64_t hash) {
+    entry_t* entry = malloc(sizeof(entry_t));
+    if (!entry) {
+        perror("allocation error");
+        exit(1);
+    }
+    arena_init_sized(&entry->arena, entry_first_chunk);
+    entry->hash = hash;
+    entry->line = copy_line(line, len, &entry->arena);
+    entry->pipelines = parse_line(copy_line(line, len, &entry->arena), &entry->arena);
+    if (!entry->pipelines.buf) {
+        arena_destroy(&entry->arena);
+        free(entry);
+        return NULL;
+    }
+
+    if (entry_count == parse_cache_capacity) {
+        remove_entry(oldest);
+    }
+    entry->next_in_bucket = buckets[hash % cache_bucket_count];
+    buckets[hash % cache_bucket_count] = entry;
+    link_as_newest(entry);
+    entry_count++;
+    return entry;
+}
+
+// A heredoc body differs from one occurrence of the line to another, so such a line is parsed every time.
+static bool has_heredoc(const char* line) {
+    return strstr(line, "<<") != NULL;
+}
+
+buffer_t parse_cache_parse(const char* line, reader_t* reader, arena_t* arena) {
+    size_t len = strlen(line);
+    if (len > max_cached_line || has_heredoc(line)) {
+        // Heredoc bodies are read after the line, which may move it in the reader's buffer, so a copy is parsed.
+        buffer_t pipelines = parse_line(copy_line(line, len, arena), arena);
+        parse_heredocs(pipelines, reader, arena);
+        return pipelines;
+    }
+
+    uint64_t hash = hash_line(line);
+    entry_t* entry = find_entry(line, hash);
+    if (entry) {
+        unlink_from_order(entry);
+        link_as_newest(entry);
+    } else {
+        entry = add_entry(line, len, hash);
+    }
+    if (!entry) {
+        buffer_t failed = {.buf = NULL, .count = 0, .size = 0, .element_size = 0, .arena = NULL};
+        return failed;
+    }
+    return entry->pipelines;
+}
+
+struct script_entry_s {
+    uint64_t hash;
+    // The line as it was read, while the pipelines point into the line, which is unescaped in place.
+    const char* line;
+    buffer_t pipelines;
+    struct script_entry_s* next_in_bucket;
+};
+
+void script_lines_init(script_lines_t* lines, arena_t* arena) {
+    lines->arena = arena;
+    lines->bucket_count = script_initial_buckets;
+    lines->count = 0;
+    lines->buckets = arena_alloc(arena, lines->bucket_count * sizeof(script_entry_t*));
+    memset(lines->buckets, 0, lines->bucket_count * sizeof(script_entry_t*));
+}
+
+// Doubles the buckets, once there are as many lines as buckets. The old ones stay in the arena until it is destroyed.
+static void grow_script_buckets(script_lines_t* lines) {
+    size_t new_count = lines->bucket_count * 2;
+    script_entry_t** new_buckets = arena_alloc(lines->arena, new_count * sizeof(script_entry_t*));
+    memset(new_buckets, 0, new_count * sizeof(script_entry_t*));
+    for (size_t i = 0; i < lines->bucket_count; ++i) {
+        script_entry_t* entry = lines->buckets[i];
+        while (entry) {
+            script_entry_t* next = entry->next_in_bucket;
+            entry->next_in_bucket = new_buckets[entry->hash % new_count];
+            new_buckets[entry->hash % new_count] = entry;
+            entry = next;
+        }
+    }
+    lines->buckets = new_buckets;
+    lines->bucket_count = new_count;
+}
+
+buffer_t script_lines_parse(script_lines_t* lines, char* line, reader_t* reader) {
+    if (has_heredoc(line)) {
+        buffer_t pipelines = parse_line(line, lines->arena);
+        parse_heredocs(pipelines, reader, lines->arena);
+        return pipelines;
+    }
+
+    uint64_t hash = hash_line(line);
+    for (script_entry_t* entry = lines->buckets[hash % lines->bucket_count]; entry; entry = entry->next_in_bucket) {
+        if (entry->hash == hash && !strcmp(entry->line, line)) {
+            return entry->pipelines;
+        }
+    }
+    const char* original = copy_line(line, strlen(line), lines->arena);
+    buffer_t pipelines = parse_line(line, lines->arena);
+    if (!pipelines.buf) {
+        // A syntax error isn't remembered, so it is reported at every occurrence of the line.
+        return pipelines;
+    }
+
+    if (lines->count == lines->bucket_count) {
+        grow_script_buckets(lines);
+    }
+    script_entry_t* entry = arena_alloc(lines->arena, sizeof(script_entry_t));
+    entry->hash = hash;
+    entry->line = original;
+    entry->pipelines = pipelines;
+    entry->next_in_bucket = lines->buckets[hash % lines->bucket_count];
+    lines->buckets[hash % lines->bucket_count] = entry;
+    lines->count++;
+    return pipelines;
+}
@@ -5,51 +5,74 @@
 #include "parser.h"
 #include "support.h"
 
-char *get_line() {
-    buffer_t line = new_buffer(sizeof(char));
+typedef enum token_kind_e {
+    TokenWord,
+    TokenPipe,
+    TokenOr,
+    TokenBackground,
+    TokenAnd,
+    TokenRedirect,
+    TokenAppend,
+    TokenInput,
+    TokenHeredoc,
+    TokenHereString,
+} token_kind_t;
 
-    char looking_for_endline = 0;
-    while (true) {
-        char c = getchar();
+// A word is a slice of the line, unescaped in place. Operators are known by their kind alone.
+typedef struct token_s {
+    token_kind_t kind;
+    char* str;
+    size_t len;
+} token_t;
 
-        if (c == '"' || c == '\'' || c == '`') {
-            if (!looking_for_endline) {
-                looking_for_endline = c;
-            } else if (looking_for_endline == c) {
-                looking_for_endline = 0;
-            }
-        } else if (c == '\n') {
-            if (!looking_for_endline) {
-                break;
-            }
-        } else if (c == '\\') {
-            char next = getchar();
-            if (next == EOF) {
-                free(line.buf);
-                return NULL;
-            } else if (next == '\n') {
-                continue;
-            } else {
-                buffer_push_back(&line, &c);
-                buffer_push_back(&line, &next);
-                continue;
-            }
-        } else if (c == EOF) {
-            free(line.buf);
-            return NULL;
-        }
-
-        buffer_push_back(&line, &c);
+static const char* token_text(const token_t* token) {
+    switch (token->kind) {
+        case TokenWord:
+            return token->str;
+        case TokenPipe:
+            return "|";
+        case TokenOr:
+            return "||";
+        case TokenBackground:
+            return "&";
+        case TokenAnd:
+            return "&&";
+        case TokenRedirect:
+            return ">";
+        case TokenAppend:
+            return ">>";
+        case TokenInput:
+            return "<";
+        case TokenHeredoc:
+            return "<<";
+        case TokenHereString:
+            return "<<<";
     }
-    char guard = '\0';
-    buffer_push_back(&line, &guard);
-    return line.buf;
+    return "";
 }
 
-static char *get_token(const char *line, int* shift) {
-    int i = 0;
+// Operators are '|', '&', '>' and the same characters doubled, and '<' repeated up to three times.
+static token_kind_t operator_kind(char c, size_t repeats) {
+    if (c == '|') {
+        return repeats == 2 ? TokenOr : TokenPipe;
+    } else if (c == '&') {
+        return repeats == 2 ? TokenAnd : TokenBackground;
+    } else if (c == '<') {
+        return repeats == 3 ? TokenHereString : (repeats == 2 ? TokenHeredoc : TokenInput);
+    }
+    return repeats == 2 ? TokenAppend : TokenRedirect;
+}
 
-    buffer_t token = new_buffer(1);
+// Reads the token, which starts at line[*pos], and moves *pos past it.
+// The characters of a word are written back to its start with escapes and quotes removed, so the word never takes
+// more room than it did in the line.
+//
+// Returns: false, if there is no token. The rest of the line isn't tokenized then.
+static bool get_token(char *line, size_t *pos, token_t *token) {
+    size_t i = *pos;
+    size_t out = i;
+    token->kind = TokenWord;
+    token->str = &line[i];
     while (line[i]) {
         if (line[i] == '#') {
             while (line[i]) {
@@ -57,7 +80,11 @@ static char *get_token(const char *line, int* shift) {
             }
             break;
         } else if (line[i] == '\\') {
-            buffer_push_back(&token, &line[i + 1]);
+            if (!line[i + 1]) {
+                i++;
+                break;
+            }
+            line[out++] = line[i + 1];
             i += 2;
         } else if ('\'' == line[i] || line[i] == '"') {
             char cur = line[i];
@@ -66,13 +93,13 @@ static char *get_token(const char *line, int* shift) {
             while (line[i] && (line[i] != cur || (guard))) {
                 if (line[i] == '\\') {
                     if (guard) {
-                        buffer_push_back(&token, &line[i]);
+                        line[out++] = line[i];
                         guard = false;
                     } else {
                         guard = true;
                     }
                 } else {
-                    buffer_push_back(&token, &line[i]);
+                    line[out++] = line[i];
                     guard = false;
                 }
                 ++i;
@@ -80,83 +107,110 @@ static char *get_token(const char *line, int* shift) {
             if (line[i]) {
                 ++i;
             }
-            *shift = i;
             break;
-        } else if (isspace(line[i])) {
+        } else if (isspace((unsigned char)line[i])) {
             break;
-        } else if (line[i] == '|' || line[i] == '&' || line[i] == '>') {
-            if (token.count) {
+        } else if (line[i] == '|' || line[i] == '&' || line[i] == '>' || line[i] == '<') {
+            if (out != *pos) {
                 break;
             }
-            char c = line[i];
-            buffer_push_back(&token, &c);
-            if (line[i + 1] && line[i] == line[i + 1]) {
-                buffer_push_back(&token, &c);
-                i += 2;
-                break;
+            size_t max_repeats = line[i] == '<' ? 3 : 2;
+            size_t repeats = 1;
+            while (repeats < max_repeats && line[i + repeats] == line[i]) {
+                repeats++;
             }
-            i++;
-            break;
+            token->kind = operator_kind(line[i], repeats);
+            *pos = i + repeats;
+            token->len = 0;
+            return true;
         } else {
-            char c = line[i];
-            buffer_push_back(&token, &c);
+            line[out++] = line[i];
             i++;
         }
     }
-    char guard = '\0';
-    *shift = i;
-    if (!token.count) {
-        free(token.buf);
-        return NULL;
-    }
-    buffer_push_back(&token, &guard);
-    return token.buf;
+    *pos = i;
+    token->len = out - (size_t)(token->str - line);
+    return token->len > 0;
 }
 
-static buffer_t tokenize(const char *line) {
-    buffer_t tokens = new_buffer(sizeof(char *));
+static buffer_t tokenize(char *line, arena_t* arena) {
+    buffer_t tokens = new_arena_buffer(arena, sizeof(token_t));
 
-    int i = 0;
+    size_t i = 0;
     while (line[i]) {
-        if (!isspace(line[i])) {
-            int shift;
-            char *token = get_token(&line[i], &shift);
-            if (!token) {
+        if (!isspace((unsigned char)line[i])) {
+            token_t token;
+            if (!get_token(line, &i, &token)) {
                 break;
             }
-
-            i += shift;
-
             buffer_push_back(&tokens, &token);
-
         } else {
             i++;
         }
     }
+
+    // Words are terminated only now, as the character after a word may be an operator, which had to be read first.
+    // Nothing else can follow a word right away: there is a whitespace or removed quotes in between.
+    token_t* words = tokens.buf;
+    for (size_t j = 0; j < tokens.count; ++j) {
+        if (words[j].kind == TokenWord) {
+            words[j].str[words[j].len] = '\0';
+        }
+    }
     return tokens;
 }
 
-static int get_next_command(buffer_t tokens_buf, size_t *i, command_t *cmd) {
+// Reads the input redirection at tokens[*i] and its word into cmd, and moves *i past them.
+// Returns: false on a syntax error, which is printed.
+static bool parse_input_redirect(buffer_t tokens_buf, size_t *i, command_t *cmd, arena_t* arena) {
+    token_t *tokens = tokens_buf.buf;
+    token_kind_t kind = tokens[*i].kind;
+    (*i)++;
+    if (*i == tokens_buf.count || tokens[*i].kind != TokenWord) {
+        fprintf(stderr, "Expected a word after '%s'.\n", token_text(&tokens[*i - 1]));
+        return false;
+    }
+    if (cmd->redirect_input || cmd->input_text || cmd->heredoc_delimiter) {
+        fprintf(stderr, "Only one input redirection per command is supported.\n");
+        return false;
+    }
+    token_t *word = &tokens[*i];
+    (*i)++;
+    if (kind == TokenInput) {
+        cmd->redirect_input = word->str;
+    } else if (kind == TokenHeredoc) {
+        cmd->heredoc_delimiter = word->str;
+    } else {
+        // A here-string is fed with a newline, the same as in bash.
+        cmd->input_text = arena_alloc(arena, word->len + 2);
+        memcpy(cmd->input_text, word->str, word->len);
+        cmd->input_text[word->len] = '\n';
+        cmd->input_text[word->len + 1] = '\0';
+    }
+    return true;
+}
+
+static int get_next_command(buffer_t tokens_buf, size_t *i, command_t *cmd, arena_t* arena) {
     if (*i == tokens_buf.count) {
         return 0;
     }
 
     size_t current_token = *i;
-    char **tokens = tokens_buf.buf;
+    token_t *tokens = tokens_buf.buf;
 
     // End of pipeline.
-    if (!strcmp(tokens[current_token], "&")) {
+    if (tokens[current_token].kind == TokenBackground) {
         return 0;
     }
 
-    if (!strcmp(tokens[current_token], "&&")) {
+    if (tokens[current_token].kind == TokenAnd) {
         if (current_token == 0) {
             fprintf(stderr, "'&&' cannot come as first argument.\n");
             return -1;
         }
         cmd->after_and = true;
         current_token++;
-    } else if (!strcmp(tokens[current_token], "||")) {
+    } else if (tokens[current_token].kind == TokenOr) {
         if (current_token == 0) {
             fprintf(stderr, "'||' cannot come as first argument.\n");
             return -1;
@@ -164,67 +218,58 @@ static int get_next_command(buffer_t tokens_buf, size_t *i, command_t *cmd) {
         cmd->after_or = true;
         current_token++;
     }
-    if (current_token < tokens_buf.count
-        && (!strcmp(tokens[current_token], ">")
-            || !strcmp(tokens[current_token], ">>")
-            || !strcmp(tokens[current_token], "|")
-            || !strcmp(tokens[current_token], "||")
-            || !strcmp(tokens[current_token], "&&")
-            || !strcmp(tokens[current_token], "&"))) {
-        fprintf(stderr, "Invalid syntax: '%s' not expected", tokens[current_token]);
+    if (current_token < tokens_buf.count && tokens[current_token].kind != TokenWord) {
+        fprintf(stderr, "Invalid syntax: '%s' not expected", token_text(&tokens[current_token]));
         return -1;
     } else if (current_token == tokens_buf.count) {
         fprintf(stderr, "Invalid syntax: '%s' not expected\n", (cmd->after_and ? "&&" : "||"));
         return -1;
     }
-    cmd->name = strdup(tokens[current_token]);
-    if (cmd->name == NULL) {
-        perror("couldn't copy cmd name: ");
-        exit(1);
-    }
+    // Words are slices of the line, which outlives the parsed commands, so they are used as they are.
+    cmd->name = tokens[current_token].str;
 
-    buffer_t args = new_buffer(sizeof(char*));
+    buffer_t args = new_arena_buffer(arena, sizeof(char*));
     buffer_push_back(&args, &cmd->name);
 
     current_token++;
-    while (current_token < tokens_buf.count) {
-        if (!strcmp(tokens[current_token], "&&") || !strcmp(tokens[current_token], "||")) {
-            break;
-        } else if (!strcmp(tokens[current_token], "|")) {
-            cmd->pipe_to_next = true;
-            current_token++;
-            break;
-        } else if (!strcmp(tokens[current_token], ">") || !strcmp(tokens[current_token], ">>")) {
-            if (tokens[current_token][1] == '>') { // '>>'
-                cmd->do_append = true;
-            }
-            
-            current_token++;
-            if (current_token == tokens_buf.count) {
-                fprintf(stderr, "Expected file to redirect output to.\n");
-                free_command(cmd);
-                return -1;
-            }
-
-            cmd->redirect_output = strdup(tokens[current_token]);
-            if (!cmd->redirect_output) {
-                perror("allocation error");
-                exit(1);
-            }
-
-            current_token++;
-            break;
-        } else if (!strcmp(tokens[current_token], "&")) {
-            break;
-        } else {
-            char* arg = strdup(tokens[current_token]);
-            if (!arg) {
-                perror("allocation error");
-                exit(1);
-            }
-            buffer_push_back(&args, &arg);
+    bool is_command_over = false;
+    while (current_token < tokens_buf.count && !is_command_over) {
+        switch (tokens[current_token].kind) {
+            case TokenAnd:
+            case TokenOr:
+            case TokenBackground:
+                is_command_over = true;
+                break;
+            case TokenPipe:
+                cmd->pipe_to_next = true;
+                current_token++;
+                is_command_over = true;
+                break;
+            case TokenRedirect:
+            case TokenAppend:
+                cmd->do_append = tokens[current_token].kind == TokenAppend;
+                current_token++;
+                if (current_token == tokens_buf.count || tokens[current_token].kind != TokenWord) {
+                    fprintf(stderr, "Expected file to redirect output to.\n");
+                    return -1;
+                }
+                cmd->redirect_output = tokens[current_token].str;
+                current_token++;
+                is_command_over = true;
+                break;
+            case TokenInput:
+            case TokenHeredoc:
+            case TokenHereString:
+                // Unlike the output one, an input redirection lets the command go on.
+                if (!parse_input_redirect(tokens_buf, &current_token, cmd, arena)) {
+                    return -1;
+                }
+                break;
+            case TokenWord:
+                buffer_push_back(&args, &tokens[current_token].str);
+                current_token++;
+                break;
         }
-        current_token++;
     }
 
     char* guard = NULL;
@@ -235,57 +280,79 @@ static int get_next_command(buffer_t tokens_buf, size_t *i, command_t *cmd) {
     return 1;
 }
 
-static int get_next_pipeline(buffer_t tokens, size_t *i, pipeline_t *pipeline) {
+static int get_next_pipeline(buffer_t tokens, size_t *i, pipeline_t *pipeline, arena_t* arena) {
     if (*i == tokens.count) {
         return 0;
     }
 
-    pipeline->commands = new_buffer(sizeof(command_t));
+    pipeline->commands = new_arena_buffer(arena, sizeof(command_t));
     command_t command;
     memset(&command, 0, sizeof(command_t));
     int ret = 0;
-    while ((ret = get_next_command(tokens, i, &command)) > 0) {
+    while ((ret = get_next_command(tokens, i, &command, arena)) > 0) {
         buffer_push_back(&pipeline->commands, &command);
         memset(&command, 0, sizeof(command));
     }
     if (ret == -1) {
-        free_commands(pipeline->commands);
         return -1;
     }
 
-    if (*i < tokens.count && !strcmp(((char **) tokens.buf)[*i], "&")) {
+    if (*i < tokens.count && ((token_t *) tokens.buf)[*i].kind == TokenBackground) {
         pipeline->is_async = true;
         (*i)++;
     }
     return 1;
 }
 
-void free_tokens(buffer_t tokens_buf) {
-    char **tokens = tokens_buf.buf;
-    for (size_t i = 0; i < tokens_buf.count; ++i) {
-        free(tokens[i]);
-    }
-    free(tokens_buf.buf);
-}
-
-buffer_t parse_line(char *line) {
-    buffer_t tokens = tokenize(line);
+buffer_t parse_line(char *line, arena_t* arena) {
+    buffer_t tokens = tokenize(line, arena);
 
     fflush(stdout);
-    buffer_t pipelines = new_buffer(sizeof(pipeline_t));
+    buffer_t pipelines = new_arena_buffer(arena, sizeof(pipeline_t));
     int ret;
     size_t current_token = 0;
     pipeline_t pipeline;
     memset(&pipeline, 0, sizeof(pipeline_t));
-    while ((ret = get_next_pipeline(tokens, &current_token, &pipeline)) > 0) {
+    while ((ret = get_next_pipeline(tokens, &current_token, &pipeline, arena)) > 0) {
         buffer_push_back(&pipelines, &pipeline);
         memset(&pipeline, 0, sizeof(pipeline_t));
     }
     if (ret == -1) {
-        free_pipelines(pipelines);
         pipelines.buf = NULL;
     }
-
-    free_tokens(tokens);
     return pipelines;
 }
+
+static char* read_heredoc(const char* delimiter, reader_t* reader, arena_t* arena) {
+    buffer_t body = new_arena_buffer(arena, sizeof(char));
+    char* line;
+    while ((line = reader_next_raw_line(reader)) != NULL && strcmp(line, delimiter)) {
+        for (; *line; ++line) {
+            buffer_push_back(&body, line);
+        }
+        char newline = '\n';
+        buffer_push_back(&body, &newline);
+    }
+    if (!line) {
+        fprintf(stderr, "Heredoc is delimited by the end of input, wanted '%s'.\n", delimiter);
+    }
+    char guard = '\0';
+    buffer_push_back(&body, &guard);
+    return body.buf;
+}
+
+void parse_heredocs(buffer_t pipelines, reader_t* reader, arena_t* arena) {
+    // The delimiters of a line with a syntax error are unknown, so its heredocs are taken for commands.
+    if (!pipelines.buf) {
+        return;
+    }
+    pipeline_t *pipeline = pipelines.buf;
+    for (size_t i = 0; i < pipelines.count; ++i) {
+        command_t *commands = pipeline[i].commands.buf;
+        for (size_t j = 0; j < pipeline[i].commands.count; ++j) {
+            if (commands[j].heredoc_delimiter) {
+                commands[j].input_text = read_heredoc(commands[j].heredoc_delimiter, reader, arena);
+            }
+        }
+    }
+}
@@ -0,0 +1,206 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "path_cache.h"
+#include "support.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define initial_bucket_count 64
+
+typedef struct entry_s {
+    char* name;
+    char* path;
+    size_t hits;
+    struct entry_s* next;
+} entry_t;
+
+static entry_t** buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+// PATH, which the cached entries were resolved with.
+static char* cached_path_var = NULL;
+
+static uint64_t hash_name(const char* name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *name; ++name) {
+        hash ^= (unsigned char)*name;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void free_entry(entry_t* entry) {
+    free(entry->name);
+    free(entry->path);
+    free(entry);
+}
+
+void path_cache_clear() {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        entry_t* entry = buckets[i];
+        while (entry) {
+            entry_t* next = entry->next;
+            free_entry(entry);
+            entry = next;
+        }
+        buckets[i] = NULL;
+    }
+    entry_count = 0;
+    free(cached_path_var);
+    cached_path_var = NULL;
+}
+
+static const char* current_path_var() {
+    const char* path_var = getenv("PATH");
+    return path_var ? path_var : "/bin:/usr/bin";
+}
+
+// Drops the cache, if PATH isn't the one the entries were found with.
+static void check_path_var() {
+    const char* path_var = current_path_var();
+    if (cached_path_var && !strcmp(cached_path_var, path_var)) {
+        return;
+    }
+    path_cache_clear();
+    cached_path_var = strdup(path_var);
+    if (!cached_path_var) {
+        perror("allocation error");
+        exit(1);
+    }
+}
+
+static entry_t** find_slot(const char* name) {
+    entry_t** slot = &buckets[hash_name(name) % bucket_count];
+    while (*slot && strcmp((*slot)->name, name) != 0) {
+        slot = &(*slot)->next;
+    }
+    return slot;
+}
+
+static void rehash(size_t new_bucket_count) {
+    entry_t** new_buckets = calloc(new_bucket_count, sizeof(entry_t*));
+    if (!new_buckets) {
+        perror("allocation error");
+        exit(1);
+    }
+    for (size_t i = 0; i < bucket_count; ++i) {
+        entry_t* entry = buckets[i];
+        while (entry) {
+            entry_t* next = entry->next;
+            size_t index = hash_name(entry->name) % new_bucket_count;
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_bucket_count;
+}
+
+static bool is_executable_file(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+// Scans PATH for name. Returns a newly allocated path, or NULL.
+static char* resolve(const char* name) {
+    const char* dir = cached_path_var;
+    size_t name_len = strlen(name);
+    while (true) {
+        const char* dir_end = strchr(dir, ':');
+        size_t dir_len = dir_end ? (size_t)(dir_end - dir) : strlen(dir);
+
+        // An empty entry of PATH means the current directory.
+        char* path = malloc(dir_len + name_len + 3);
+        if (!path) {
+            perror("allocation error");
+            exit(1);
+        }
+        if (dir_len) {
+            memcpy(path, dir, dir_len);
+        } else {
+            path[dir_len++] = '.';
+        }
+        path[dir_len] = '/';
+        memcpy(path + dir_len + 1, name, name_len + 1);
+        if (is_executable_file(path)) {
+            return path;
+        }
+        free(path);
+
+        if (!dir_end) {
+            return NULL;
+        }
+        dir = dir_end + 1;
+    }
+}
+
+const char* path_cache_lookup(const char* name) {
+    if (strchr(name, '/')) {
+        return name;
+    }
+    if (!buckets) {
+        rehash(initial_bucket_count);
+    }
+    check_path_var();
+
+    entry_t** slot = find_slot(name);
+    if (*slot) {
+        (*slot)->hits++;
+        return (*slot)->path;
+    }
+
+    char* path = resolve(name);
+    if (!path) {
+        return NULL;
+    }
+    entry_t* entry = malloc(sizeof(entry_t));
+    if (!entry) {
+        perror("allocation error");
+        exit(1);
+    }
+    entry->name = strdup(name);
+    if (!entry->name) {
+        perror("allocation error");
+        exit(1);
+    }
+    entry->path = path;
+    entry->hits = 1;
+    entry->next = NULL;
+    *slot = entry;
+    if (++entry_count > 2 * bucket_count) {
+        rehash(2 * bucket_count);
+    }
+    return path;
+}
+
+void path_cache_forget(const char* name) {
+    if (!buckets) {
+        return;
+    }
+    entry_t** slot = find_slot(name);
+    if (*slot) {
+        entry_t* entry = *slot;
+        *slot = entry->next;
+        free_entry(entry);
+        entry_count--;
+    }
+}
+
+void path_cache_print(int out) {
+    if (!entry_count) {
+        dprintf(out, "hash: hash table empty\n");
+        return;
+    }
+    dprintf(out, "hits\tcommand\n");
+    for (size_t i = 0; i < bucket_count; ++i) {
+        for (entry_t* entry = buckets[i]; entry; entry = entry->next) {
+            dprintf(out, "%4zu\t%s\n", entry->hits, entry->path);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "pipes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define pipes_copy_chunk (1 << 20)
+#define pipes_buffer_size (64 * 1024)
+
+static size_t pipe_size = 0;
+
+bool pipes_set_size(size_t size) {
+    if (!size) {
+        pipe_size = 0;
+        return true;
+    }
+    // The size is tried on a scratch pipe, so a refused one is reported once, and not on every chain.
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed");
+        return false;
+    }
+    int actual = -1;
+    if (size > INT_MAX) {
+        errno = EINVAL;
+    } else {
+        actual = fcntl(fds[1], F_SETPIPE_SZ, (int)size);
+    }
+    if (actual == -1) {
+        perror("Couldn't set the pipe size");
+    } else {
+        pipe_size = actual;
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return actual != -1;
+}
+
+size_t pipes_get_size() {
+    return pipe_size;
+}
+
+int pipes_create(int fds[2]) {
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    // The size was checked when it was set. If memory for it runs out now, the pipe just stays smaller.
+    if (pipe_size) {
+        fcntl(fds[1], F_SETPIPE_SZ, (int)pipe_size);
+    }
+    return 0;
+}
+
+static bool is_pipe(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+static bool copy_through_buffer(int from, int to) {
+    char buf[pipes_buffer_size];
+    ssize_t bytes_read;
+    while ((bytes_read = read(from, buf, sizeof(buf))) != 0) {
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("read error");
+            return false;
+        }
+        for (ssize_t written = 0; written < bytes_read;) {
+            ssize_t ret = write(to, buf + written, bytes_read - written);
+            if (ret == -1 && errno != EINTR) {
+                perror("write error");
+                return false;
+            }
+            written += ret == -1 ? 0 : ret;
+        }
+    }
+    return true;
+}
+
+bool pipes_copy(int from, int to) {
+    bool use_splice = is_pipe(from) || is_pipe(to);
+    bool has_moved = false;
+    while (true) {
+        ssize_t moved = use_splice ? splice(from, NULL, to, NULL, pipes_copy_chunk, SPLICE_F_MOVE)
+                                   : sendfile(to, from, NULL, pipes_copy_chunk);
+        if (moved > 0) {
+            has_moved = true;
+        } else if (moved == 0) {
+            return true;
+        } else if (errno != EINTR) {
+            // E.g. an O_APPEND file can't be spliced into. Nothing is lost, if nothing was moved yet.
+            if (has_moved || (errno != EINVAL && errno != ENOSYS)) {
+                perror("copy error");
+                return false;
+            }
+            return copy_through_buffer(from, to);
+        }
+    }
+}
@@ -0,0 +1,170 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "reader.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define initial_capacity (64 * 1024)
+
+void reader_init(reader_t* reader, int fd) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+}
+
+void reader_init_memory(reader_t* reader, char* bytes, size_t size) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    reader->buf = bytes;
+    reader->capacity = size;
+    reader->end = size;
+    reader->eof = true;
+    reader->is_memory = true;
+}
+
+void reader_destroy(reader_t* reader) {
+    if (!reader->is_memory) {
+        free(reader->buf);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+// Reads more bytes into the buffer, moving the unconsumed ones to its front first.
+// Returns: false, if there are no more bytes.
+static bool fill(reader_t* reader) {
+    if (reader->eof) {
+        return false;
+    }
+    if (reader->begin) {
+        memmove(reader->buf, reader->buf + reader->begin, reader->end - reader->begin);
+        reader->end -= reader->begin;
+        reader->begin = 0;
+    }
+    if (reader->end == reader->capacity) {
+        size_t capacity = reader->capacity ? reader->capacity * 2 : initial_capacity;
+        char* buf = realloc(reader->buf, capacity);
+        if (!buf) {
+            perror("Couldn't reallocate memory.");
+            exit(1);
+        }
+        reader->buf = buf;
+        reader->capacity = capacity;
+    }
+
+    ssize_t bytes_read;
+    do {
+        bytes_read = read(reader->fd, reader->buf + reader->end, reader->capacity - reader->end);
+    } while (bytes_read == -1 && errno == EINTR);
+    if (bytes_read <= 0) {
+        if (bytes_read == -1) {
+            perror("Couldn't read input");
+        }
+        reader->eof = true;
+        return false;
+    }
+    reader->end += bytes_read;
+    return true;
+}
+
+static bool is_special(char c) {
+    return c == '\\' || c == '\n' || c == '"' || c == '\'' || c == '`';
+}
+
+// Hands out the rest of the input, which isn't followed by a newline, if the input allows that.
+static char* finish_last_line(reader_t* reader, size_t read_pos, size_t write_pos, char looking_for_endline) {
+    if (!reader->is_memory || !read_pos) {
+        return NULL;
+    }
+    if (looking_for_endline) {
+        fprintf(stderr, "Unexpected end of input: %c is not closed\n", looking_for_endline);
+        reader->is_unterminated = true;
+        reader->begin = reader->end;
+        return NULL;
+    }
+    char* line = reader->buf + reader->begin;
+    line[write_pos] = '\0';
+    reader->begin = reader->end;
+    return line;
+}
+
+char* reader_next_line(reader_t* reader) {
+    // Offsets from begin, so they survive fill() moving the bytes.
+    size_t read_pos = 0;
+    size_t write_pos = 0;
+    char looking_for_endline = 0;
+    while (true) {
+        if (reader->begin + read_pos == reader->end && !fill(reader)) {
+            return finish_last_line(reader, read_pos, write_pos, looking_for_endline);
+        }
+        char* line = reader->buf + reader->begin;
+        size_t available = reader->end - reader->begin;
+        while (read_pos < available) {
+            // Plain characters are skipped in bulk. They are moved only if a continuation was cut out before them.
+            size_t plain_end = read_pos;
+            while (plain_end < available && !is_special(line[plain_end])) {
+                plain_end++;
+            }
+            if (write_pos != read_pos) {
+                memmove(line + write_pos, line + read_pos, plain_end - read_pos);
+            }
+            write_pos += plain_end - read_pos;
+            read_pos = plain_end;
+            if (read_pos == available) {
+                break;
+            }
+
+            char c = line[read_pos];
+            if (c == '\\') {
+                if (read_pos + 1 == available) {
+                    // The escaped character isn't read yet.
+                    break;
+                }
+                if (line[read_pos + 1] != '\n') {
+                    line[write_pos++] = c;
+                    line[write_pos++] = line[read_pos + 1];
+                }
+                read_pos += 2;
+                continue;
+            } else if (c == '\n') {
+                if (!looking_for_endline) {
+                    line[write_pos] = '\0';
+                    reader->begin += read_pos + 1;
+                    return line;
+                }
+            } else if (!looking_for_endline) {
+                looking_for_endline = c;
+            } else if (looking_for_endline == c) {
+                looking_for_endline = 0;
+            }
+            line[write_pos++] = c;
+            read_pos++;
+        }
+        if (read_pos < available && !fill(reader)) {
+            return NULL;
+        }
+    }
+}
+
+char* reader_next_raw_line(reader_t* reader) {
+    // Offset from begin, so it survives fill() moving the bytes.
+    size_t scanned = 0;
+    while (true) {
+        if (reader->begin + scanned == reader->end && !fill(reader)) {
+            return finish_last_line(reader, scanned, scanned, 0);
+        }
+        char* line = reader->buf + reader->begin;
+        size_t available = reader->end - reader->begin;
+        char* newline = memchr(line + scanned, '\n', available - scanned);
+        if (newline) {
+            *newline = '\0';
+            reader->begin += newline - line + 1;
+            return line;
+        }
+        scanned = available;
+    }
+}
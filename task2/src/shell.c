@@ -4,9 +4,21 @@
 
 #include "shell.h"
 #include "parser.h"
+#include "parse_cache.h"
+#include "launcher.h"
+#include "builtins.h"
+#include "jobs.h"
+#include "pipes.h"
+#include "trace.h"
+#include "zygote.h"
+#include "reader.h"
 
 #include <wait.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 
 static char default_prompt[] = "$> ";
 static char *prompt = default_prompt;
@@ -24,8 +36,26 @@ void set_prompt(const char *new_prompt) {
 }
 
 
+// Whether chains get process groups of their own. A background pipeline keeps all its commands in its own group,
+// so that the job is stopped and continued as a whole.
+static bool is_job_control = false;
+
+// Chains get process groups of their own only if the shell runs in the foreground of a terminal, which it passes to
+// them. Otherwise a command reading the terminal would be stopped in a group, which never gets it.
+static void init_job_control() {
+    is_job_control = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+    jobs_init(is_job_control);
+    if (is_job_control) {
+        // The shell takes the terminal back from finished commands, while being in the background itself.
+        signal(SIGTTOU, SIG_IGN);
+    }
+}
+
 static void shell_init() {
     set_shell_signal_handlers();
+    set_job_signal_handlers();
+    zygote_start();
+    init_job_control();
 }
 
 static void redirect_output_to_fd(int old, int new) {
@@ -46,128 +76,372 @@ static void redirect_output_to_file(const char *output, bool do_append) {
     redirect_output_to_fd(fd, STDOUT_FILENO);
 }
 
-static int exec_cd(command_t cmd) {
-    char* pwd = cmd.args[1];
-    if (pwd == NULL) {
-        pwd = getenv("HOME");
-        if (pwd == NULL) {
-            return 1;
+// The reader of the commands, if they come from stdin. It may already hold the lines after the current one.
+static reader_t *command_reader = NULL;
+// The same reader, while a builtin runs in the shell on the shell's own stdin.
+static reader_t *builtin_input = NULL;
+
+reader_t *shell_stdin_reader() {
+    return builtin_input;
+}
+
+static bool is_builtin(command_t cmd) {
+    return find_builtin(cmd.name) != NULL;
+}
+
+// Opens the input redirection of cmd. A here-string or a heredoc body is written into a memfd, so no process has to
+// feed it through a pipe.
+// Returns: false on error, which is printed. *fd is the opened descriptor, or -1, if cmd reads the usual stdin.
+static bool open_input(command_t cmd, int *fd) {
+    *fd = -1;
+    if (cmd.redirect_input) {
+        *fd = open(cmd.redirect_input, O_RDONLY | O_CLOEXEC);
+        if (*fd == -1) {
+            perror(cmd.redirect_input);
+            return false;
+        }
+    } else if (cmd.input_text) {
+        *fd = memfd_create("heredoc", MFD_CLOEXEC);
+        if (*fd == -1) {
+            perror("memfd_create error");
+            return false;
+        }
+        size_t size = strlen(cmd.input_text);
+        for (size_t written = 0; written < size;) {
+            ssize_t ret = pwrite(*fd, cmd.input_text + written, size - written, written);
+            if (ret == -1 && errno != EINTR) {
+                perror("Couldn't write heredoc");
+                close(*fd);
+                *fd = -1;
+                return false;
+            }
+            written += ret == -1 ? 0 : ret;
         }
-    } else if (cmd.args[2]) {
+    }
+    return true;
+}
+
+// Runs a builtin, which is a whole chain on its own, without any process. Its redirection goes to a descriptor of its
+// own, so the shell's stdout stays as it is. Its input redirection replaces the shell's stdin only while it runs.
+static int exec_builtin_in_shell(command_t cmd) {
+    int input;
+    if (!open_input(cmd, &input)) {
         return 1;
     }
-    return chdir(pwd);
+    int saved_stdin = -1;
+    if (input != -1) {
+        saved_stdin = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0);
+        dup2(input, STDIN_FILENO);
+        close(input);
+    }
+
+    int out = STDOUT_FILENO;
+    if (cmd.redirect_output != NULL) {
+        out = open(cmd.redirect_output, O_WRONLY | O_CREAT | O_CLOEXEC | (cmd.do_append ? O_APPEND : O_TRUNC), 0655);
+    }
+    int result = 1;
+    if (out != -1) {
+        builtin_input = input == -1 ? command_reader : NULL;
+        result = find_builtin(cmd.name)(cmd, out);
+        builtin_input = NULL;
+    } else {
+        perror("Couldn't open file");
+    }
+    if (out != STDOUT_FILENO && out != -1) {
+        close(out);
+    }
+    if (saved_stdin != -1) {
+        dup2(saved_stdin, STDIN_FILENO);
+        close(saved_stdin);
+    }
+    return result;
 }
 
-static int exec_exit(command_t cmd) {
-    if (cmd.pipe_to_next) {
-        if (cmd.args[1]) {
-            return atoi(cmd.args[1]);
-        }
-        return 0;
+// Builtins in a chain of pipes run in their own process, the same as in other shells.
+static void exec_builtin_stage(command_t cmd, pid_t pgid, int pipe_in, int pipe_out, int unused_end) {
+    if (pgid != -1) {
+        setpgid(0, pgid);
+    }
+    set_command_signal_handlers();
+
+    if (unused_end != -1) {
+        close(unused_end);
+    }
+    if (cmd.redirect_output != NULL) {
+        redirect_output_to_file(cmd.redirect_output, cmd.do_append);
+    }
+    if (pipe_in != -1) {
+        redirect_output_to_fd(pipe_in, STDIN_FILENO);
     }
-    if (cmd.args[1]) {
-        exit(atoi(cmd.args[1]));
+    if (pipe_out != -1) {
+        redirect_output_to_fd(pipe_out, STDOUT_FILENO);
     }
-    exit(0);
+
+    exit(find_builtin(cmd.name)(cmd, STDOUT_FILENO));
 }
 
-static void execute_commands(command_t *commands, size_t count) {
-    int last_result = 0;
+// Runs a builtin in the shell the same way, but measures it as a stage, which takes its time out of the shell's own.
+static int exec_builtin_measured(command_t cmd, bool is_timed) {
+    stage_times_t stage = {.pid = 0, .spawn_started_ns = trace_now_ns(), .spawned_ns = 0};
+    stage.spawned_ns = stage.spawn_started_ns;
+    struct rusage before;
+    getrusage(RUSAGE_SELF, &before);
 
-    int pipe_in = 0;
-    int pipe_out = 1;
-    for (size_t i = 0; i < count; ++i) {
-        if ((commands[i].after_and && last_result != 0)
-            || (commands[i].after_or && last_result == 0)) {
-            continue;
+    int result = exec_builtin_in_shell(cmd);
+
+    process_usage_t usage;
+    getrusage(RUSAGE_SELF, &usage.usage);
+    usage.reaped_ns = trace_now_ns();
+    timersub(&usage.usage.ru_utime, &before.ru_utime, &usage.usage.ru_utime);
+    timersub(&usage.usage.ru_stime, &before.ru_stime, &usage.usage.ru_stime);
+    trace_report_chain(&cmd, 1, &stage, &usage, stage.spawned_ns, is_timed);
+    return result;
+}
+
+// Runs commands[0, count), connected with pipes, as one process group.
+// All the stages are started before any of them is waited for, so they stream into each other instead of filling
+// a pipe and blocking. The stages are measured, if the chain is timed or traced.
+// Returns: the result of the last stage.
+static int run_chain(command_t *commands, size_t count, bool is_timed) {
+    bool is_measured = is_timed || trace_is_enabled();
+    if (count == 1 && is_builtin(commands[0])) {
+        return is_measured ? exec_builtin_measured(commands[0], is_timed) : exec_builtin_in_shell(commands[0]);
+    }
+
+    pid_t *pids = calloc(count, sizeof(pid_t));
+    stage_times_t *stages = is_measured ? calloc(count, sizeof(stage_times_t)) : NULL;
+    process_usage_t *usages = is_measured ? calloc(count, sizeof(process_usage_t)) : NULL;
+    if (!pids || (is_measured && (!stages || !usages))) {
+        perror("allocation error");
+        exit(1);
+    }
+    // -1 keeps the commands in the group of the shell.
+    pid_t pgid = is_job_control ? 0 : -1;
+    size_t started = 0;
+    int pipe_in = -1;
+    for (; started < count; ++started) {
+        int pipes[2] = {-1, -1};
+        if (started + 1 < count && pipes_create(pipes) == -1) {
+            perror("pipe failed");
+            break;
         }
-        if (!strcmp(commands[i].name, "cd")) {
-            last_result = exec_cd(commands[i]);
-            continue;
-        } else if (!strcmp(commands[i].name, "exit")) {
-            last_result = exec_exit(commands[i]);
-            continue;
+
+        // An input redirection wins over the pipe, whose writer sees it closed then.
+        int input;
+        bool is_input_ok = open_input(commands[started], &input);
+        if (input != -1 && pipe_in != -1) {
+            close(pipe_in);
+        }
+        if (input != -1) {
+            pipe_in = input;
         }
 
-        int pipes[2];
-        if (commands[i].pipe_to_next) {
-            if (pipe(pipes) == -1) {
-                perror("pipe failed");
-                return;
+        // Only builtins need a copy of the shell. External commands are spawned without copying its memory.
+        if (stages) {
+            stages[started].spawn_started_ns = trace_now_ns();
+        }
+        pid_t pid = -1;
+        if (is_input_ok && is_builtin(commands[started])) {
+            pid = fork();
+            if (pid == 0) {
+                free(pids);
+                free(stages);
+                free(usages);
+                exec_builtin_stage(commands[started], pgid, pipe_in, pipes[1], pipes[0]);
+            } else if (pid < 0) {
+                perror("fork error");
             }
-            pipe_out = pipes[1];
+        } else if (is_input_ok) {
+            pid = launch_command(commands[started], pgid, pipe_in, pipes[1], pipes[0]);
         }
 
-        int pid = fork();
-        if (pid == 0) {
-            set_command_signal_handlers();
-
-            if (commands[i].redirect_output != NULL) {
-                redirect_output_to_file(commands[i].redirect_output, commands[i].do_append);
-            }
-            if (i > 0 && commands[i - 1].pipe_to_next) {
-                redirect_output_to_fd(pipe_in, STDIN_FILENO);
-            }
-            if (commands[i].pipe_to_next) {
-                close(pipes[0]);
-                redirect_output_to_fd(pipe_out, STDOUT_FILENO);
+        // A stage, which couldn't be started, fails. The rest of the chain still runs and sees its pipe closed.
+        pids[started] = pid;
+        if (stages) {
+            stages[started].pid = pid;
+            stages[started].spawned_ns = trace_now_ns();
+        }
+        if (pid > 0 && is_job_control) {
+            // Both the shell and the child set the group, so it is in place whoever runs first.
+            if (!pgid) {
+                pgid = pid;
+                jobs_give_terminal_to(pgid);
             }
+            setpgid(pid, pgid);
+        }
 
-            execvp(commands[i].name, commands[i].args);
-            perror("exec error");
-            exit(1);
-        } else if (pid > 0) {
-            if (commands[i].pipe_to_next) {
-                close(pipe_out);
-                pipe_in = pipes[0];
-            } else if (i > 0 && commands[i - 1].pipe_to_next) {
-                close(pipe_in);
-            }
+        if (pipe_in != -1) {
+            close(pipe_in);
+        }
+        if (pipes[1] != -1) {
+            close(pipes[1]);
+        }
+        pipe_in = pipes[0];
+    }
+    if (pipe_in != -1) {
+        close(pipe_in);
+    }
 
-            int stat;
-            waitpid(pid, &stat, 0);
-            last_result = WEXITSTATUS(stat);
-        } else {
-            perror("fork error");
-            break;
+    int result = 1;
+    if (started) {
+        uint64_t wait_started_ns = is_measured ? trace_now_ns() : 0;
+        result = jobs_wait_foreground(pgid > 0 ? pgid : 0, pids, started, commands, count, usages);
+        if (is_measured) {
+            trace_report_chain(commands, started, stages, usages, wait_started_ns, is_timed);
         }
     }
+    free(pids);
+    free(stages);
+    free(usages);
+    jobs_give_terminal_to(getpgrp());
+
+    // A chain, which couldn't be started completely, is a failure, whatever its started stages returned.
+    if (started < count) {
+        return 1;
+    }
+    return result;
+}
+
+// 'time' prefixes a whole chain. It is taken off the first command, and the chain is run timed.
+static int execute_chain(command_t *commands, size_t count) {
+    if (strcmp(commands[0].name, "time") != 0 || !commands[0].args[1]) {
+        return run_chain(commands, count, false);
+    }
+    // The parsed commands stay as they are, so the chain is run from a copy.
+    command_t *timed = malloc(count * sizeof(command_t));
+    if (!timed) {
+        perror("allocation error");
+        exit(1);
+    }
+    memcpy(timed, commands, count * sizeof(command_t));
+    timed[0].args++;
+    timed[0].name = timed[0].args[0];
+    int result = run_chain(timed, count, true);
+    free(timed);
+    return result;
 }
 
-static void execute_pipeline(pipeline_t pipeline) {
+static int execute_commands(command_t *commands, size_t count) {
+    int last_result = 0;
+
+    size_t i = 0;
+    while (i < count) {
+        size_t chain_end = i + 1;
+        while (chain_end < count && commands[chain_end - 1].pipe_to_next) {
+            chain_end++;
+        }
+        if (!(commands[i].after_and && last_result != 0)
+            && !(commands[i].after_or && last_result == 0)) {
+            last_result = execute_chain(&commands[i], chain_end - i);
+        }
+        i = chain_end;
+    }
+    return last_result;
+}
+
+// Returns: the result of the pipeline. A pipeline started in the background succeeds.
+static int execute_pipeline(pipeline_t pipeline) {
     if (pipeline.is_async) {
-        int pid = fork();
+        pid_t pid = fork();
         if (pid == 0) {
-            execute_commands(pipeline.commands.buf, pipeline.commands.count);
-            exit(0);
+            // A background pipeline is a job of its own, which may not take the terminal.
+            setpgid(0, 0);
+            set_command_signal_handlers();
+            jobs_reset_in_child();
+            is_job_control = false;
+            // The shell goes on reading the commands, so the copy of its reader is stale.
+            command_reader = NULL;
+            exit(execute_commands(pipeline.commands.buf, pipeline.commands.count));
+        } else if (pid < 0) {
+            perror("fork error");
+            return 1;
         }
-    } else {
-        execute_commands(pipeline.commands.buf, pipeline.commands.count);
+        setpgid(pid, pid);
+        jobs_add_background(pid, pipeline.commands.buf, pipeline.commands.count);
+        return 0;
+    }
+    return execute_commands(pipeline.commands.buf, pipeline.commands.count);
+}
+
+static int execute_line(buffer_t buf_of_pipelines) {
+    int result = 0;
+    pipeline_t *pipelines = buf_of_pipelines.buf;
+    for (size_t i = 0; i < buf_of_pipelines.count; ++i) {
+        result = execute_pipeline(pipelines[i]);
     }
+    return result;
 }
 
-void run_loop() {
+int run_loop() {
     shell_init();
 
+    int result = 0;
+    reader_t reader;
+    reader_init(&reader, STDIN_FILENO);
+    command_reader = &reader;
+    arena_t arena;
+    arena_init(&arena);
     while (1) {
+        jobs_reap();
         print_prompt();
-        char *line = get_line();
+        char *line = reader_next_line(&reader);
         if (!line) {
             break;
         }
-        buffer_t buf_of_pipelines = parse_line(line);
-        if (!buf_of_pipelines.buf) {
-            free(line);
-            continue;
-        }
+        // Repeated lines are parsed once, through the parse cache.
+        uint64_t parse_started_ns = trace_now_ns();
+        size_t len = strlen(line);
+        buffer_t buf_of_pipelines = parse_cache_parse(line, &reader, &arena);
+        trace_parse(len, parse_started_ns);
+        result = buf_of_pipelines.buf ? execute_line(buf_of_pipelines) : 2;
+        arena_reset(&arena);
+    }
+    arena_destroy(&arena);
+    parse_cache_clear();
+    command_reader = NULL;
+    reader_destroy(&reader);
+    return result;
+}
 
-        pipeline_t *pipelines = buf_of_pipelines.buf;
-        for (size_t i = 0; i < buf_of_pipelines.count; ++i) {
-            execute_pipeline(pipelines[i]);
-        }
+int run_script(char *bytes, size_t size) {
+    set_job_signal_handlers();
+    zygote_start();
+    init_job_control();
+
+    reader_t reader;
+    reader_init_memory(&reader, bytes, size);
 
-        free_pipelines(buf_of_pipelines);
-        free(line);
+    // All the lines are parsed before the first one runs. A line with a syntax error is reported and skipped.
+    // The script is parsed once, so all of it shares one arena. A repeated line is parsed only at its first occurrence.
+    arena_t arena;
+    arena_init(&arena);
+    script_lines_t script_lines;
+    script_lines_init(&script_lines, &arena);
+    buffer_t lines = new_arena_buffer(&arena, sizeof(buffer_t));
+    char *line;
+    while ((line = reader_next_line(&reader)) != NULL) {
+        uint64_t parse_started_ns = trace_now_ns();
+        size_t len = strlen(line);
+        buffer_t buf_of_pipelines = script_lines_parse(&script_lines, line, &reader);
+        trace_parse(len, parse_started_ns);
+        buffer_push_back(&lines, &buf_of_pipelines);
+    }
+    if (reader.is_unterminated) {
+        buffer_t failed_line = {.buf = NULL, .count = 0, .size = 0, .element_size = 0};
+        buffer_push_back(&lines, &failed_line);
+    }
+    reader_destroy(&reader);
+
+    int result = 0;
+    buffer_t *parsed = lines.buf;
+    for (size_t i = 0; i < lines.count; ++i) {
+        if (!parsed[i].buf) {
+            result = 2;
+            continue;
+        }
+        result = execute_line(parsed[i]);
+        jobs_reap();
     }
+    arena_destroy(&arena);
+    return result;
 }
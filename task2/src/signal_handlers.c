@@ -3,6 +3,7 @@
 //
 
 #include "shell.h"
+#include "jobs.h"
 
 #include <signal.h>
 #include <stdio.h>
@@ -18,6 +19,23 @@ void set_shell_signal_handlers() {
     signal(SIGINT, shell_handler);
 }
 
-void set_command_signal_handlers() {
+static void child_handler(int signal) {
+    jobs_note_child_event();
+}
 
+void set_job_signal_handlers() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = child_handler;
+    // Reads and waits go on after the signal, the jobs are reaped between lines.
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+}
+
+void set_command_signal_handlers() {
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
 }
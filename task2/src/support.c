@@ -4,10 +4,8 @@
 
 #include "support.h"
 
-#include "commands.h"
-
 buffer_t new_buffer(size_t size_element) {
-    buffer_t buf = {.count=0,.size=5, .element_size=size_element,.buf=NULL};
+    buffer_t buf = {.count=0,.size=5, .element_size=size_element,.buf=NULL, .arena=NULL};
 
     buf.buf = realloc(NULL, buf.size * buf.element_size);
     if (!buf.buf) {
@@ -18,49 +16,29 @@ buffer_t new_buffer(size_t size_element) {
     return buf;
 }
 
+buffer_t new_arena_buffer(arena_t* arena, size_t size_element) {
+    buffer_t buf = {.count=0,.size=8, .element_size=size_element,.buf=NULL, .arena=arena};
+    buf.buf = arena_alloc(arena, buf.size * buf.element_size);
+    return buf;
+}
+
 void buffer_push_back(buffer_t* buf, const void* element) {
     if (buf->count == buf->size) {
         buf->size *= 2;
-        buf->buf = realloc(buf->buf, buf->size * buf->element_size);
-        if (!buf->buf) {
-            perror("Couldn't reallocate memory.");
-            exit(1);
+        if (buf->arena) {
+            // The old memory stays in the arena until it is reset.
+            void* new_buf = arena_alloc(buf->arena, buf->size * buf->element_size);
+            memcpy(new_buf, buf->buf, buf->count * buf->element_size);
+            buf->buf = new_buf;
+        } else {
+            buf->buf = realloc(buf->buf, buf->size * buf->element_size);
+            if (!buf->buf) {
+                perror("Couldn't reallocate memory.");
+                exit(1);
+            }
         }
     }
 
     memcpy((char*)buf->buf + buf->count * buf->element_size, element, buf->element_size);
     buf->count++;
 }
-
-void free_command(command_t *command) {
-    // free(commands[i].name); name will be cleared as args[0] is pointing to it also.
-    free(command->redirect_output);
-    int i = 0;
-    while (command->args[i]) {
-        free(command->args[i]);
-        i++;
-    }
-    free(command->args);
-}
-
-void free_commands(buffer_t cmds) {
-    command_t* commands = cmds.buf;
-
-    for (size_t i = 0; i < cmds.count; ++i) {
-        free_command(&commands[i]);
-    }
-    free(commands);
-}
-
-void free_pipeline(pipeline_t *pipeline) {
-    free_commands(pipeline->commands);
-}
-
-void free_pipelines(buffer_t pipelines) {
-    pipeline_t* ps = pipelines.buf;
-
-    for (size_t i = 0; i < pipelines.count; ++i) {
-        free_pipeline(&ps[i]);
-    }
-    free(ps);
-}
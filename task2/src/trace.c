@@ -0,0 +1,99 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "trace.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+
+// The variable is looked up on the first use.
+#define trace_fd_unknown (-2)
+
+static int trace_fd = trace_fd_unknown;
+
+uint64_t trace_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+bool trace_is_enabled() {
+    if (trace_fd == trace_fd_unknown) {
+        const char* target = getenv("CSHELL_TRACE");
+        trace_fd = -1;
+        if (target && !strcmp(target, "1")) {
+            trace_fd = STDERR_FILENO;
+        } else if (target && *target) {
+            trace_fd = open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (trace_fd == -1) {
+                perror(target);
+            }
+        }
+    }
+    return trace_fd != -1;
+}
+
+static double to_us(uint64_t ns) {
+    return ns / 1e3;
+}
+
+static double to_seconds(const struct timeval* time) {
+    return time->tv_sec + time->tv_usec / 1e6;
+}
+
+void trace_parse(size_t len, uint64_t started_ns) {
+    if (trace_is_enabled()) {
+        dprintf(trace_fd, "cshell_trace event=parse bytes=%zu parse_us=%.1f\n", len,
+                to_us(trace_now_ns() - started_ns));
+    }
+}
+
+static void print_times(const command_t* commands, size_t count, const stage_times_t* stages,
+                        const process_usage_t* usages) {
+    uint64_t ended_ns = stages[0].spawn_started_ns;
+    double user = 0;
+    double sys = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (stages[i].pid == -1 || !usages[i].reaped_ns) {
+            fprintf(stderr, "%-12s %s\n", commands[i].name, stages[i].pid == -1 ? "not started" : "not finished");
+            continue;
+        }
+        const struct rusage* usage = &usages[i].usage;
+        fprintf(stderr, "%-12s real %.3fs  user %.3fs  sys %.3fs  maxrss %ldKiB\n", commands[i].name,
+                (usages[i].reaped_ns - stages[i].spawn_started_ns) / 1e9, to_seconds(&usage->ru_utime),
+                to_seconds(&usage->ru_stime), usage->ru_maxrss);
+        user += to_seconds(&usage->ru_utime);
+        sys += to_seconds(&usage->ru_stime);
+        ended_ns = usages[i].reaped_ns > ended_ns ? usages[i].reaped_ns : ended_ns;
+    }
+    fprintf(stderr, "real %.3fs  user %.3fs  sys %.3fs\n", (ended_ns - stages[0].spawn_started_ns) / 1e9, user, sys);
+}
+
+void trace_report_chain(const command_t* commands, size_t count, const stage_times_t* stages,
+                        const process_usage_t* usages, uint64_t wait_started_ns, bool is_timed) {
+    if (is_timed) {
+        print_times(commands, count, stages, usages);
+    }
+    if (!trace_is_enabled()) {
+        return;
+    }
+    // spawn is the cost of starting the stage, run lasts from then until it is reaped, and wait is the part of it,
+    // which the shell spent blocked on the chain.
+    for (size_t i = 0; i < count; ++i) {
+        if (stages[i].pid == -1 || !usages[i].reaped_ns) {
+            dprintf(trace_fd, "cshell_trace event=command name=%s stage=%zu %s\n", commands[i].name, i,
+                    stages[i].pid == -1 ? "started=0" : "finished=0");
+            continue;
+        }
+        const struct rusage* usage = &usages[i].usage;
+        uint64_t reaped_ns = usages[i].reaped_ns;
+        dprintf(trace_fd, "cshell_trace event=command name=%s pid=%d stage=%zu spawn_us=%.1f run_us=%.1f "
+                          "wait_us=%.1f user_us=%.0f sys_us=%.0f maxrss_kib=%ld\n",
+                commands[i].name, (int)stages[i].pid, i, to_us(stages[i].spawned_ns - stages[i].spawn_started_ns),
+                to_us(reaped_ns - stages[i].spawned_ns),
+                to_us(reaped_ns > wait_started_ns ? reaped_ns - wait_started_ns : 0),
+                to_seconds(&usage->ru_utime) * 1e6, to_seconds(&usage->ru_stime) * 1e6, usage->ru_maxrss);
+    }
+}
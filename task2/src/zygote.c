@@ -0,0 +1,276 @@
+//
+// Created by dgolear on 19.10.2026.
+//
+
+#include "zygote.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Longer requests are spawned by the shell. A datagram has to fit into the socket buffer anyway.
+#define max_request_size (64 * 1024)
+#define stdio_count 3
+#define command_stack_size (64 * 1024)
+
+typedef struct request_header_s {
+    pid_t pgid;
+    uint32_t argc;
+    // Followed by the '\0'-terminated working directory, path and arguments.
+} request_header_t;
+
+typedef struct reply_s {
+    pid_t pid;
+    int error;
+} reply_t;
+
+static int zygote_socket = -1;
+// The shell, which started the zygote. Only it can use the zygote.
+static pid_t owner_pid = -1;
+
+// What the command is started with. It shares the memory of the zygote until exec, so it passes its error back here.
+typedef struct command_start_s {
+    const char* cwd;
+    const char* path;
+    char** args;
+    pid_t pgid;
+    const int* fds;
+    int error;
+} command_start_t;
+
+// The command runs on a stack of its own until exec, as the zygote's one is in use.
+static alignas(max_align_t) char command_stack[command_stack_size];
+
+// Runs in the command, cloned by the zygote.
+static int exec_command(void* arg) {
+    command_start_t* start = arg;
+    if (start->pgid != -1) {
+        setpgid(0, start->pgid);
+    }
+    int signals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU};
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+        signal(signals[i], SIG_DFL);
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+
+    // The received descriptors are above stdio, as the zygote keeps its own stdio open.
+    for (int i = 0; i < stdio_count; ++i) {
+        dup2(start->fds[i], i);
+    }
+    if (chdir(start->cwd) == 0) {
+        execv(start->path, start->args);
+    }
+    start->error = errno;
+    _exit(127);
+}
+
+static reply_t start_command(const char* cwd, const char* path, char** args, pid_t pgid,
+                             const int fds[stdio_count]) {
+    command_start_t start = {.cwd = cwd, .path = path, .args = args, .pgid = pgid, .fds = fds, .error = 0};
+    // The same as with posix_spawn, the command doesn't copy the zygote's memory, and the zygote sleeps until exec.
+    // CLONE_PARENT makes the command a child of the shell, not of the zygote.
+    reply_t reply;
+    reply.pid = clone(exec_command, command_stack + sizeof(command_stack),
+                      CLONE_VM | CLONE_VFORK | CLONE_PARENT | SIGCHLD, &start);
+    reply.error = reply.pid == -1 ? errno : start.error;
+    return reply;
+}
+
+// Takes a request apart and starts the command. Returns: the reply to it.
+static reply_t serve_request(char* request, size_t size, const int fds[stdio_count]) {
+    reply_t invalid = {.pid = -1, .error = EINVAL};
+    request_header_t header;
+    if (size < sizeof(header) || request[size - 1] != '\0') {
+        return invalid;
+    }
+    memcpy(&header, request, sizeof(header));
+    char* strings = request + sizeof(header);
+    char* end = request + size;
+
+    // Working directory, path and the arguments follow one another.
+    char** args = calloc(header.argc + 1, sizeof(char*));
+    if (!args) {
+        reply_t failed = {.pid = -1, .error = ENOMEM};
+        return failed;
+    }
+    char* cwd = strings;
+    char* path = cwd + strlen(cwd) + 1;
+    char* arg = path < end ? path + strlen(path) + 1 : end;
+    for (uint32_t i = 0; i < header.argc && arg < end; ++i) {
+        args[i] = arg;
+        arg += strlen(arg) + 1;
+    }
+    reply_t reply = invalid;
+    if (path < end && header.argc && args[header.argc - 1]) {
+        reply = start_command(cwd, path, args, header.pgid, fds);
+    }
+    free(args);
+    return reply;
+}
+
+static void serve(int sock) {
+    // The zygote shares the shell's process group, so keys from the terminal reach it too.
+    int ignored[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU};
+    for (size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); ++i) {
+        signal(ignored[i], SIG_IGN);
+    }
+    signal(SIGCHLD, SIG_DFL);
+
+    char* request = malloc(max_request_size);
+    if (!request) {
+        _exit(1);
+    }
+    while (true) {
+        union {
+            char buf[CMSG_SPACE(stdio_count * sizeof(int))];
+            struct cmsghdr align;
+        } control;
+        struct iovec iov = {.iov_base = request, .iov_len = max_request_size};
+        struct msghdr msg = {.msg_name = NULL, .msg_namelen = 0, .msg_iov = &iov, .msg_iovlen = 1,
+                             .msg_control = control.buf, .msg_controllen = sizeof(control.buf), .msg_flags = 0};
+        ssize_t size = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (size == -1 && errno == EINTR) {
+            continue;
+        } else if (size <= 0) {
+            // The shell is gone.
+            break;
+        }
+
+        int fds[stdio_count] = {-1, -1, -1};
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        bool has_fds = cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+                       && cmsg->cmsg_len == CMSG_LEN(sizeof(fds));
+        if (has_fds) {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        }
+        reply_t reply = {.pid = -1, .error = EINVAL};
+        if (has_fds && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+            reply = serve_request(request, size, fds);
+        }
+        for (int i = 0; i < stdio_count; ++i) {
+            if (fds[i] != -1) {
+                close(fds[i]);
+            }
+        }
+        send(sock, &reply, sizeof(reply), MSG_NOSIGNAL);
+    }
+    free(request);
+}
+
+void zygote_start() {
+    const char* enabled = getenv("CSHELL_ZYGOTE");
+    if (!enabled || strcmp(enabled, "1") != 0 || zygote_socket != -1) {
+        return;
+    }
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+        perror("zygote: socketpair error");
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("zygote: fork error");
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        serve(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    zygote_socket = fds[0];
+    owner_pid = getpid();
+}
+
+bool zygote_is_running() {
+    return zygote_socket != -1 && getpid() == owner_pid;
+}
+
+// Stops using the zygote after an error of the socket. The shell spawns the commands itself from now on.
+static void zygote_fail(const char* what) {
+    perror(what);
+    close(zygote_socket);
+    zygote_socket = -1;
+}
+
+// Appends str along with its '\0' to the request. Returns: false, if the request would be too long.
+static bool append_string(char* request, size_t* size, const char* str) {
+    size_t len = strlen(str) + 1;
+    if (*size + len > max_request_size) {
+        return false;
+    }
+    memcpy(request + *size, str, len);
+    *size += len;
+    return true;
+}
+
+int zygote_spawn(pid_t* pid, const char* path, char** args, pid_t pgid, const int fds[3]) {
+    static char request[max_request_size];
+    static char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        return -1;
+    }
+
+    request_header_t header = {.pgid = pgid, .argc = 0};
+    size_t size = sizeof(header);
+    if (!append_string(request, &size, cwd) || !append_string(request, &size, path)) {
+        return -1;
+    }
+    for (; args[header.argc]; ++header.argc) {
+        if (!append_string(request, &size, args[header.argc])) {
+            return -1;
+        }
+    }
+    memcpy(request, &header, sizeof(header));
+
+    union {
+        char buf[CMSG_SPACE(stdio_count * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {.iov_base = request, .iov_len = size};
+    struct msghdr msg = {.msg_name = NULL, .msg_namelen = 0, .msg_iov = &iov, .msg_iovlen = 1,
+                         .msg_control = control.buf, .msg_controllen = sizeof(control.buf), .msg_flags = 0};
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(stdio_count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, stdio_count * sizeof(int));
+
+    ssize_t ret;
+    while ((ret = sendmsg(zygote_socket, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR) {
+    }
+    if (ret == -1) {
+        zygote_fail("zygote: send error");
+        return -1;
+    }
+    reply_t reply;
+    while ((ret = recv(zygote_socket, &reply, sizeof(reply), 0)) == -1 && errno == EINTR) {
+    }
+    if (ret != sizeof(reply)) {
+        zygote_fail("zygote: receive error");
+        return -1;
+    }
+
+    // A command, whose exec failed, is still a child of the shell, and has to be reaped.
+    if (reply.error && reply.pid > 0) {
+        while (waitpid(reply.pid, NULL, 0) == -1 && errno == EINTR) {
+        }
+    }
+    *pid = reply.pid;
+    return reply.error;
+}